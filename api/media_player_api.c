@@ -10,6 +10,9 @@
 #include <stdio.h>
 #include <gst/gst.h>
 #include "media_player_api.h"
+#include "media_player_snapshot.h"
+#include "media_player_analytics.h"
+#include "media_player_throttle.h"
 
 
 /***************** Defines **********************/
@@ -31,21 +34,150 @@
 #define BLUE_TEXT     "\x1B[34m"
 #define CYAN_TEXT     "\x1B[36m"
 
+/* Share of its full decode load a player needs when only decoding key frames */
+#define KEY_UNITS_LOAD_FACTOR 0.1
+
 /***************** Structures and Enums *********/
 struct MediaPlayer
 {
    GstElement *p_element;
    gulong media_player_signal_handler_id;
    MpMessageCallback mp_message_callback;
+   const MediaPlayerSnapshot *p_snapshot;
+
+   /* Governor state, protected by governor_mutex */
+   gulong   decode_load_handler_id;
+   gint     priority;
+   gboolean wants_play;
+   MpThrottle throttle;
+   guint    decode_threads;
 };
 
 /***************** Private Global Variables *************/
 static GMutex   init_mutex = {0};
 static gboolean lib_inited = FALSE;
 
+/* Decode resource governor, shares the core budget among all players */
+static GMutex   governor_mutex       = {0};
+static GList   *p_governor_players   = NULL;
+static guint    governor_core_budget = 0; /* 0 is all processors */
+
 /***************** Private Function Definitions **********/
 
 /****************** Private Functions *******************/
+/**
+ * \brief Sort players highest priority first
+ * 
+ * \param[in] p_a - first player
+ * \param[in] p_b - second player
+ * 
+ * \return gint - negative if p_a goes first
+ * \author Jason Neitzert
+ */
+static gint media_player_governor_compare(gconstpointer p_a, gconstpointer p_b)
+{
+   return ((const MediaPlayer*)p_b)->priority - ((const MediaPlayer*)p_a)->priority;
+}
+
+/**
+ * \brief Hand out the core budget to playing players in priority order
+ * \details Players that fit in what is left of the budget run unthrottled,
+ *          those that only fit decoding key frames are throttled to that,
+ *          and the rest are paused. The highest priority player is never
+ *          throttled. Must be called with governor_mutex held.
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void media_player_governor_rebalance_locked()
+{
+   gdouble      budget    = governor_core_budget ? governor_core_budget : g_get_num_processors();
+   gdouble      remaining = budget;
+   gdouble      load      = 0.0;
+   guint        active    = 0;
+   guint        threads   = 0;
+   GList       *p_item    = NULL;
+   MediaPlayer *p_player  = NULL;
+   MpThrottle   throttle  = eMP_THROTTLE_NONE;
+
+   /* Stable sort, so equal priorities are served in the order they were created */
+   p_governor_players = g_list_sort(p_governor_players, media_player_governor_compare);
+
+   for (p_item = p_governor_players; p_item; p_item = p_item->next)
+   {
+      p_player = p_item->data;
+      throttle = eMP_THROTTLE_NONE;
+
+      if (p_player->wants_play)
+      {
+         g_object_get(p_player->p_element, "decode-load", &load, NULL);
+
+         if (!active || (load <= remaining))
+         {
+            remaining -= load;
+            active++;
+         }
+         else if ((load * KEY_UNITS_LOAD_FACTOR) <= remaining)
+         {
+            remaining -= load * KEY_UNITS_LOAD_FACTOR;
+            throttle   = eMP_THROTTLE_KEY_UNITS;
+         }
+         else
+         {
+            throttle = eMP_THROTTLE_PAUSED;
+         }
+      }
+
+      if (throttle != p_player->throttle)
+      {
+         p_player->throttle = throttle;
+         g_object_set(p_player->p_element, "throttle", (guint)throttle, NULL);
+      }
+   }
+
+   /* Stop unthrottled players' decoders from each spawning a thread per core */
+   threads = MAX(1, (guint)budget / MAX(active, 1));
+
+   for (p_item = p_governor_players; p_item; p_item = p_item->next)
+   {
+      p_player = p_item->data;
+
+      if (threads != p_player->decode_threads)
+      {
+         p_player->decode_threads = threads;
+         g_object_set(p_player->p_element, "decode-threads", threads, NULL);
+      }
+   }
+}
+
+/**
+ * \brief Rebalance the governor
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void media_player_governor_rebalance()
+{
+   g_mutex_lock(&governor_mutex);
+   media_player_governor_rebalance_locked();
+   g_mutex_unlock(&governor_mutex);
+}
+
+/**
+ * \brief Rebalance once a player knows what its video costs to decode
+ * 
+ * \param[in] p_element - player element
+ * \param[in] p_pspec   - the decode-load property
+ * \param[in] user_data - unused
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void mediaplayer_decode_load_notify(GstElement *p_element, GParamSpec *p_pspec, gpointer user_data)
+{
+   media_player_governor_rebalance();
+}
+
 /**
  * \brief Media Player Debug handler for gstreamer debug
  * 
@@ -95,9 +227,44 @@ static void media_player_log(GstDebugCategory *p_category,
  */
 static void mediaplayer_message_callback(GstElement *p_element, GstMessage *p_message, MediaPlayer *p_media_player)
 {
-   if (p_media_player->mp_message_callback)
+   MpMessage message = eMP_EOS;
+   guint     event   = eMPA_EVENT_NONE;
+   gboolean  known   = TRUE;
+
+   /* Anything other than EOS is an analytics element message */
+   if (GST_MESSAGE_ELEMENT == GST_MESSAGE_TYPE(p_message))
    {
-      p_media_player->mp_message_callback(eMP_EOS);
+      (void)gst_structure_get_uint(gst_message_get_structure(p_message), "event", &event);
+
+      switch (event)
+      {
+         case eMPA_EVENT_SCENE_CHANGE:
+         {
+            message = eMP_SCENE_CHANGE;
+            break;
+         }
+         case eMPA_EVENT_BLACK_FRAME:
+         {
+            message = eMP_BLACK_FRAME;
+            break;
+         }
+         case eMPA_EVENT_FROZEN_FRAME:
+         {
+            message = eMP_FROZEN_FRAME;
+            break;
+         }
+         default:
+         {
+            /* Events newer than the api (or a missing event field) aren't reported */
+            known = FALSE;
+            break;
+         }
+      }
+   }
+
+   if (known && p_media_player->mp_message_callback)
+   {
+      p_media_player->mp_message_callback(message);
    }     
 }
 
@@ -176,6 +343,18 @@ MediaPlayer *media_player_new(MpMessageCallback mp_message_callback)
    else
    {
       p_media_player->mp_message_callback = mp_message_callback;
+
+      /* Snapshot lives as long as the element, so fetch it once here */
+      g_object_get(p_media_player->p_element, "snapshot", &p_media_player->p_snapshot, NULL);
+
+      p_media_player->decode_load_handler_id = 
+         g_signal_connect(p_media_player->p_element, "notify::decode-load",
+                          (GCallback)mediaplayer_decode_load_notify, NULL);
+
+      g_mutex_lock(&governor_mutex);
+      p_governor_players = g_list_append(p_governor_players, p_media_player);
+      media_player_governor_rebalance_locked();
+      g_mutex_unlock(&governor_mutex);
    }
    
    return p_media_player;
@@ -191,8 +370,22 @@ MediaPlayer *media_player_new(MpMessageCallback mp_message_callback)
  */
 void media_player_destroy(MediaPlayer *p_media_player)
 {
+   /* Give our share of the budget to the other players */
+   g_mutex_lock(&governor_mutex);
+   if (g_list_find(p_governor_players, p_media_player))
+   {
+      p_governor_players = g_list_remove(p_governor_players, p_media_player);
+      media_player_governor_rebalance_locked();
+   }
+   g_mutex_unlock(&governor_mutex);
+
    /* We don't care about failure her as we will try to continue with destruction */
    (void)gst_element_set_state(p_media_player->p_element, GST_STATE_NULL);
+
+   if (p_media_player->decode_load_handler_id)
+   {
+      g_signal_handler_disconnect(p_media_player->p_element, p_media_player->decode_load_handler_id);
+   }
    g_signal_handler_disconnect(p_media_player->p_element, p_media_player->media_player_signal_handler_id);
    gst_object_unref(p_media_player->p_element);
    g_slice_free(MediaPlayer, p_media_player);
@@ -210,6 +403,12 @@ bool media_player_play(MediaPlayer *p_media_player)
 {
    bool retval = true;
 
+   /* Throttle before going to playing, so we don't start decoding what we can't afford */
+   g_mutex_lock(&governor_mutex);
+   p_media_player->wants_play = TRUE;
+   media_player_governor_rebalance_locked();
+   g_mutex_unlock(&governor_mutex);
+
    if (GST_STATE_CHANGE_FAILURE ==  gst_element_set_state(p_media_player->p_element, GST_STATE_PLAYING))
    {
       retval = false;
@@ -235,6 +434,257 @@ bool media_player_pause(MediaPlayer *p_media_player)
       retval = false;
    }
 
+   /* Release the budget once paused, so the players that get it don't overlap with us */
+   g_mutex_lock(&governor_mutex);
+   p_media_player->wants_play = FALSE;
+   media_player_governor_rebalance_locked();
+   g_mutex_unlock(&governor_mutex);
+
+   return retval;
+}
+
+/**
+ * \brief Get current playback position
+ * \details Reads the player snapshot only, never queries the pipeline.
+ * 
+ * \param[in]  p_media_player - pointer to media player object
+ * \param[out] p_position_ns  - position in nanoseconds
+ * 
+ * \return bool - true if position is known
+ * \author Jason Neitzert
+ */
+bool media_player_get_position(MediaPlayer *p_media_player, int64_t *p_position_ns)
+{
+   GstClockTime position = GST_CLOCK_TIME_NONE;
+
+   media_player_snapshot_read(p_media_player->p_snapshot, &position, NULL, NULL);
+   
+   if (GST_CLOCK_TIME_IS_VALID(position))
+   {
+      *p_position_ns = (int64_t)position;
+   }
+
+   return GST_CLOCK_TIME_IS_VALID(position);
+}
+
+/**
+ * \brief Get duration of the current media
+ * \details Reads the player snapshot only, never queries the pipeline.
+ * 
+ * \param[in]  p_media_player - pointer to media player object
+ * \param[out] p_duration_ns  - duration in nanoseconds
+ * 
+ * \return bool - true if duration is known
+ * \author Jason Neitzert
+ */
+bool media_player_get_duration(MediaPlayer *p_media_player, int64_t *p_duration_ns)
+{
+   GstClockTime duration = GST_CLOCK_TIME_NONE;
+
+   media_player_snapshot_read(p_media_player->p_snapshot, NULL, &duration, NULL);
+   
+   if (GST_CLOCK_TIME_IS_VALID(duration))
+   {
+      *p_duration_ns = (int64_t)duration;
+   }
+
+   return GST_CLOCK_TIME_IS_VALID(duration);
+}
+
+/**
+ * \brief Get state the player pipeline has reached
+ * \details Reads the player snapshot only, never queries the pipeline.
+ * 
+ * \param[in] p_media_player - pointer to media player object
+ * 
+ * \return MpState - current state
+ * \author Jason Neitzert
+ */
+MpState media_player_get_state(MediaPlayer *p_media_player)
+{
+   GstState state  = GST_STATE_NULL;
+   MpState  retval = eMP_STATE_NULL;
+
+   media_player_snapshot_read(p_media_player->p_snapshot, NULL, NULL, &state);
+
+   switch (state)
+   {
+      case GST_STATE_READY:
+      {
+         retval = eMP_STATE_READY;
+         break;
+      }
+      case GST_STATE_PAUSED:
+      {
+         retval = eMP_STATE_PAUSED;
+         break;
+      }
+      case GST_STATE_PLAYING:
+      {
+         retval = eMP_STATE_PLAYING;
+         break;
+      }
+      default:
+      {
+         retval = eMP_STATE_NULL;
+         break;
+      }
+   }
+
    return retval;
 }
 
+/**
+ * \brief Turn frame analytics on or off
+ * \details While on, scene change, black frame and frozen frame messages
+ *          are delivered through the message callback.
+ * 
+ * \param[in] p_media_player - pointer to media player object
+ * \param[in] enable         - true to analyse frames
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+void media_player_set_analytics(MediaPlayer *p_media_player, bool enable)
+{
+   g_object_set(p_media_player->p_element, "analytics", (gboolean)enable, NULL);
+}
+
+/**
+ * \brief Export decoded frames to shared memory for other local processes
+ * \details Takes effect the next time the player leaves the NULL state.
+ *          Consumers attach with media_player_shm_attach(p_socket_path).
+ * 
+ * \param[in] p_media_player - pointer to media player object
+ * \param[in] p_socket_path  - Unix socket to listen for consumers on, NULL to disable
+ * \param[in] slot_count     - number of frames in the shared ring
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+void media_player_set_shm_export(MediaPlayer *p_media_player, const char *p_socket_path, unsigned int slot_count)
+{
+   g_object_set(p_media_player->p_element, "shm-socket-path", p_socket_path, "shm-slots", slot_count, NULL);
+}
+
+/**
+ * \brief Get counters of the shared memory export
+ * \details All 0 while the player isn't exporting.
+ * 
+ * \param[in]  p_media_player - pointer to media player object
+ * \param[out] p_stats        - the counters
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+void media_player_get_shm_export_stats(MediaPlayer *p_media_player, MpShmExportStats *p_stats)
+{
+   guint64 published = 0;
+   guint64 copied    = 0;
+   guint64 dropped   = 0;
+
+   g_object_get(p_media_player->p_element, "shm-published", &published, "shm-copied", &copied,
+                "shm-dropped", &dropped, NULL);
+
+   p_stats->published = published;
+   p_stats->copied    = copied;
+   p_stats->dropped   = dropped;
+}
+
+/**
+ * \brief Set the media the player plays
+ * \details Takes effect the next time the player leaves the NULL state.
+ * 
+ * \param[in] p_media_player - pointer to media player object
+ * \param[in] p_uri          - URI of the media
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+void media_player_set_uri(MediaPlayer *p_media_player, const char *p_uri)
+{
+   g_object_set(p_media_player->p_element, "uri", p_uri, NULL);
+}
+
+/**
+ * \brief Set how many cores the governor shares among all players
+ * 
+ * \param[in] cores - cores to share, 0 for all processors
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+void media_player_governor_set_core_budget(unsigned int cores)
+{
+   g_mutex_lock(&governor_mutex);
+   governor_core_budget = cores;
+   media_player_governor_rebalance_locked();
+   g_mutex_unlock(&governor_mutex);
+}
+
+/**
+ * \brief Set player priority
+ * \details When decoding is oversubscribed higher priority players get
+ *          cores first and lower ones are throttled. Players default to 0.
+ * 
+ * \param[in] p_media_player - pointer to media player object
+ * \param[in] priority       - priority, higher wins
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+void media_player_set_priority(MediaPlayer *p_media_player, int priority)
+{
+   g_mutex_lock(&governor_mutex);
+   p_media_player->priority = priority;
+   media_player_governor_rebalance_locked();
+   g_mutex_unlock(&governor_mutex);
+}
+
+/**
+ * \brief Get how the governor is throttling the player
+ * 
+ * \param[in] p_media_player - pointer to media player object
+ * 
+ * \return MpThrottle - current throttle
+ * \author Jason Neitzert
+ */
+MpThrottle media_player_get_throttle(MediaPlayer *p_media_player)
+{
+   MpThrottle throttle = eMP_THROTTLE_NONE;
+
+   g_mutex_lock(&governor_mutex);
+   throttle = p_media_player->throttle;
+   g_mutex_unlock(&governor_mutex);
+
+   return throttle;
+}
+
+/**
+ * \brief Get number of frames dropped for being late since leaving NULL state
+ * 
+ * \param[in] p_media_player - pointer to media player object
+ * 
+ * \return uint64_t - dropped frames
+ * \author Jason Neitzert
+ */
+uint64_t media_player_get_dropped_frames(MediaPlayer *p_media_player)
+{
+   return media_player_snapshot_get_dropped(p_media_player->p_snapshot);
+}
+
+/**
+ * \brief Choose where decoded frames are allocated from
+ * \details Takes effect the next time decoders negotiate allocation, normally
+ *          when the player next leaves the NULL state.
+ * 
+ * \param[in] p_media_player - pointer to media player object
+ * \param[in] frame_arena    - arena to use
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+void media_player_set_frame_arena(MediaPlayer *p_media_player, MpFrameArena frame_arena)
+{
+   g_object_set(p_media_player->p_element, "frame-arena", (guint)frame_arena, NULL);
+}
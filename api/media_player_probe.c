@@ -0,0 +1,726 @@
+/*************************************************
+* \file      media_player_probe.c
+* \details   Media Player probe Implementation. Finds duration, codecs,
+*            resolution and tracks of a file with a discovery pipeline that
+*            stops at parsers, so nothing is decoded. Results are kept in a
+*            cache keyed by path, mtime and size, in memory until a cache
+*            file is set and then saved to it.
+* \author    Jason Neitzert
+* \date      10/19/2026
+* \Copyright Jason Neitzert
+*************************************************/
+
+/***************** Includes *********************/
+#include <string.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+#include <gst/gst.h>
+#include "media_player_api.h"
+
+/***************** Defines **********************/
+/* Longest to wait for the discovery pipeline to preroll, however many messages it posts */
+#define PROBE_TIMEOUT (5 * GST_SECOND)
+
+#define PROBE_CACHE_MAGIC   0x4d505043 /* "MPPC" */
+#define PROBE_CACHE_VERSION 1
+
+/* Part of MpMediaInfo before the tracks, only n_tracks tracks are stored on disk */
+#define PROBE_INFO_FIXED_SIZE (G_STRUCT_OFFSET(MpMediaInfo, tracks))
+
+/***************** Structures and Enums *********/
+/* Outcome of running the discovery pipeline on a file */
+typedef enum
+{
+   ePROBE_MEDIA,     /* Media with at least one track */
+   ePROBE_NOT_MEDIA, /* Typefinding found no media type, or plain text, so it will never be media */
+   ePROBE_FAILED     /* Timed out, unreadable or missing a plugin, worth trying again later */
+} ProbeResult;
+
+/* State shared with the discovery pipeline's streaming threads */
+typedef struct
+{
+   GstElement  *p_pipeline;
+   GMutex       mutex;
+   MpMediaInfo *p_info;
+} ProbeContext;
+
+/* What is known about a path, also for files that turned out not to be media */
+typedef struct
+{
+   gint64      mtime;
+   gint64      size;
+   gboolean    is_media;
+   MpMediaInfo info;
+} ProbeCacheEntry;
+
+/* Start of the cache file */
+typedef struct
+{
+   guint32 magic;
+   guint32 version;
+   guint32 track_size; /* sizeof(MpTrackInfo), so a changed layout isn't misread */
+   guint32 count;
+} ProbeCacheHeader;
+
+/* Start of each cache file record, followed by the info and then the path */
+typedef struct
+{
+   guint32 path_len;
+   guint32 is_media;
+   gint64  mtime;
+   gint64  size;
+} ProbeCacheRecord;
+
+/* State of one media_player_probe_scan */
+typedef struct
+{
+   MpProbeScanCallback callback;
+   void               *p_user_data;
+   guint               media_files;
+} ProbeScan;
+
+/***************** Private Global Variables *************/
+static GMutex      probe_cache_mutex  = {0};
+static GHashTable *p_probe_cache      = NULL; /* Path -> ProbeCacheEntry, made on first store */
+static gchar      *p_probe_cache_path = NULL;
+static gboolean    probe_cache_dirty  = FALSE;
+
+/****************** Private Functions *******************/
+/**
+ * \brief Stop autoplugging once a stream is parsed, so no decoders are made
+ *
+ * \param[in] p_decodebin - uridecodebin of the discovery pipeline
+ * \param[in] p_pad       - pad being autoplugged
+ * \param[in] p_caps      - caps of p_pad
+ * \param[in] p_context   - probe context
+ *
+ * \return gboolean - TRUE to keep autoplugging, FALSE to expose the pad as is
+ * \author Jason Neitzert
+ */
+static gboolean probe_autoplug_continue(GstElement *p_decodebin, GstPad *p_pad, GstCaps *p_caps, ProbeContext *p_context)
+{
+   GstStructure *p_structure = gst_caps_get_structure(p_caps, 0);
+   gboolean      parsed      = FALSE;
+   gboolean      framed      = FALSE;
+
+   (void)gst_structure_get_boolean(p_structure, "parsed", &parsed);
+   (void)gst_structure_get_boolean(p_structure, "framed", &framed);
+
+   return !(parsed || framed);
+}
+
+/**
+ * \brief Add a track described by caps to the probe result
+ *
+ * \param[in] p_info - probe result
+ * \param[in] p_caps - fixed caps of the track
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void probe_add_track(MpMediaInfo *p_info, GstCaps *p_caps)
+{
+   GstStructure *p_structure = gst_caps_get_structure(p_caps, 0);
+   const gchar  *p_name      = gst_structure_get_name(p_structure);
+   MpTrackInfo  *p_track     = NULL;
+
+   if (p_info->n_tracks < MP_PROBE_MAX_TRACKS)
+   {
+      p_track = &p_info->tracks[p_info->n_tracks++];
+      memset(p_track, 0, sizeof(MpTrackInfo));
+      g_strlcpy(p_track->codec, p_name, sizeof(p_track->codec));
+
+      if (g_str_has_prefix(p_name, "video/") || g_str_has_prefix(p_name, "image/"))
+      {
+         p_track->type = eMP_TRACK_VIDEO;
+         (void)gst_structure_get_int(p_structure, "width", &p_track->width);
+         (void)gst_structure_get_int(p_structure, "height", &p_track->height);
+         (void)gst_structure_get_fraction(p_structure, "framerate", &p_track->framerate_num, &p_track->framerate_den);
+      }
+      else if (g_str_has_prefix(p_name, "audio/"))
+      {
+         p_track->type = eMP_TRACK_AUDIO;
+         (void)gst_structure_get_int(p_structure, "channels", &p_track->channels);
+         (void)gst_structure_get_int(p_structure, "rate", &p_track->sample_rate);
+      }
+      else if (g_str_has_prefix(p_name, "text/") || g_str_has_prefix(p_name, "subpicture/") ||
+               g_str_has_prefix(p_name, "subtitle/") || !strcmp(p_name, "application/x-ssa") ||
+               !strcmp(p_name, "application/x-ass"))
+      {
+         p_track->type = eMP_TRACK_SUBTITLE;
+      }
+      else
+      {
+         p_track->type = eMP_TRACK_OTHER;
+      }
+   }
+}
+
+/**
+ * \brief Record a stream the discovery pipeline exposed and give it a sink to preroll
+ *
+ * \param[in] p_decodebin - uridecodebin of the discovery pipeline
+ * \param[in] p_pad       - new pad
+ * \param[in] p_context   - probe context
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void probe_pad_added(GstElement *p_decodebin, GstPad *p_pad, ProbeContext *p_context)
+{
+   GstElement *p_sink     = gst_element_factory_make("fakesink", NULL);
+   GstPad     *p_sink_pad = NULL;
+   GstCaps    *p_caps     = gst_pad_get_current_caps(p_pad);
+
+   if (p_caps)
+   {
+      g_mutex_lock(&p_context->mutex);
+      probe_add_track(p_context->p_info, p_caps);
+      g_mutex_unlock(&p_context->mutex);
+      gst_caps_unref(p_caps);
+   }
+
+   if (!p_sink)
+   {
+      GST_ERROR("Failed to create fakesink for probe");
+   }
+   else
+   {
+      g_object_set(p_sink, "sync", FALSE, NULL);
+      gst_bin_add((GstBin*)p_context->p_pipeline, p_sink);
+
+      p_sink_pad = gst_element_get_static_pad(p_sink, "sink");
+      if (GST_PAD_LINK_OK != gst_pad_link(p_pad, p_sink_pad))
+      {
+         GST_ERROR("Failed to link probe stream to fakesink");
+      }
+      gst_object_unref(p_sink_pad);
+
+      (void)gst_element_sync_state_with_parent(p_sink);
+   }
+}
+
+/**
+ * \brief Run the discovery pipeline on a file
+ * \details Prerolls uridecodebin, autoplugging only as far as parsers, into
+ *          fakesinks. Only the first buffer of each stream is read.
+ *
+ * \param[in]  p_path - local file to probe
+ * \param[out] p_info - what was found
+ *
+ * \return ProbeResult - ePROBE_NOT_MEDIA only if typefinding says it isn't media
+ * \author Jason Neitzert
+ */
+static ProbeResult probe_discover(const gchar *p_path, MpMediaInfo *p_info)
+{
+   ProbeContext  context     = {0};
+   GstElement   *p_decodebin = NULL;
+   GstBus       *p_bus       = NULL;
+   GstMessage   *p_message   = NULL;
+   GstTagList   *p_tags      = NULL;
+   gchar        *p_uri       = NULL;
+   gchar        *p_container = NULL;
+   GError       *p_error     = NULL;
+   gint64        duration    = 0;
+   GstClockTime  deadline    = 0;
+   GstClockTime  now         = 0;
+   gboolean      prerolled   = FALSE;
+   gboolean      not_media   = FALSE;
+   gboolean      done        = FALSE;
+   ProbeResult   result      = ePROBE_FAILED;
+
+   memset(p_info, 0, sizeof(MpMediaInfo));
+   p_info->duration_ns = -1;
+   context.p_info      = p_info;
+   g_mutex_init(&context.mutex);
+
+   if (!(p_uri = gst_filename_to_uri(p_path, NULL)))
+   {
+      GST_ERROR("Failed to make uri for %s", p_path);
+   }
+   else if (!(context.p_pipeline = gst_pipeline_new(NULL)) ||
+            !(p_decodebin = gst_element_factory_make("uridecodebin", NULL)))
+   {
+      GST_ERROR("Failed to create probe pipeline");
+   }
+   else
+   {
+      g_object_set(p_decodebin, "uri", p_uri, NULL);
+      g_signal_connect(p_decodebin, "autoplug-continue", (GCallback)probe_autoplug_continue, &context);
+      g_signal_connect(p_decodebin, "pad-added", (GCallback)probe_pad_added, &context);
+      gst_bin_add((GstBin*)context.p_pipeline, p_decodebin);
+
+      p_bus = gst_element_get_bus(context.p_pipeline);
+
+      if (GST_STATE_CHANGE_FAILURE != gst_element_set_state(context.p_pipeline, GST_STATE_PAUSED))
+      {
+         /* One deadline for the whole probe, so a stream of tags can't keep extending it */
+         deadline = gst_util_get_timestamp() + PROBE_TIMEOUT;
+         while (!done && ((now = gst_util_get_timestamp()) < deadline) &&
+                (p_message = gst_bus_timed_pop_filtered(p_bus, deadline - now, GST_MESSAGE_ASYNC_DONE |
+                                                        GST_MESSAGE_ERROR | GST_MESSAGE_TAG)))
+         {
+            if (GST_MESSAGE_TAG == GST_MESSAGE_TYPE(p_message))
+            {
+               gst_message_parse_tag(p_message, &p_tags);
+
+               if (!p_info->container[0] && gst_tag_list_get_string(p_tags, GST_TAG_CONTAINER_FORMAT, &p_container))
+               {
+                  g_strlcpy(p_info->container, p_container, sizeof(p_info->container));
+                  g_free(p_container);
+               }
+
+               gst_tag_list_unref(p_tags);
+            }
+            else if (GST_MESSAGE_ERROR == GST_MESSAGE_TYPE(p_message))
+            {
+               gst_message_parse_error(p_message, &p_error, NULL);
+               /* decodebin reports text files as the wrong type rather than typefinding failing */
+               not_media = g_error_matches(p_error, GST_STREAM_ERROR, GST_STREAM_ERROR_TYPE_NOT_FOUND) ||
+                           g_error_matches(p_error, GST_STREAM_ERROR, GST_STREAM_ERROR_WRONG_TYPE);
+               g_error_free(p_error);
+               done      = TRUE;
+            }
+            else
+            {
+               prerolled = TRUE;
+               done      = TRUE;
+            }
+
+            gst_message_unref(p_message);
+         }
+      }
+
+      if (prerolled && gst_element_query_duration(context.p_pipeline, GST_FORMAT_TIME, &duration))
+      {
+         p_info->duration_ns = duration;
+      }
+
+      (void)gst_element_set_state(context.p_pipeline, GST_STATE_NULL);
+      gst_object_unref(p_bus);
+   }
+
+   if (context.p_pipeline)
+   {
+      gst_object_unref(context.p_pipeline);
+   }
+
+   g_free(p_uri);
+   g_mutex_clear(&context.mutex);
+
+   if (prerolled && p_info->n_tracks)
+   {
+      result = ePROBE_MEDIA;
+   }
+   else if (not_media)
+   {
+      result = ePROBE_NOT_MEDIA;
+   }
+
+   return result;
+}
+
+/**
+ * \brief Load the cache file into p_probe_cache. Must hold probe_cache_mutex.
+ * \details A missing file is an empty cache. Stops at the first bad record.
+ *
+ * \return gboolean - TRUE unless the file exists and couldn't be read
+ * \author Jason Neitzert
+ */
+static gboolean probe_cache_load_locked()
+{
+   gchar            *p_contents = NULL;
+   gsize             length     = 0;
+   gsize             offset     = sizeof(ProbeCacheHeader);
+   ProbeCacheHeader  header;
+   ProbeCacheRecord  record;
+   ProbeCacheEntry  *p_entry    = NULL;
+   GError           *p_error    = NULL;
+   gboolean          loaded     = TRUE;
+   guint32           i          = 0;
+
+   if (!g_file_get_contents(p_probe_cache_path, &p_contents, &length, &p_error))
+   {
+      loaded = g_error_matches(p_error, G_FILE_ERROR, G_FILE_ERROR_NOENT);
+      if (!loaded)
+      {
+         GST_ERROR("Failed to read probe cache: %s", p_error->message);
+      }
+      g_error_free(p_error);
+   }
+   else
+   {
+      if (length >= sizeof(header))
+      {
+         memcpy(&header, p_contents, sizeof(header));
+      }
+
+      if ((length < sizeof(header)) || (PROBE_CACHE_MAGIC != header.magic) ||
+          (PROBE_CACHE_VERSION != header.version) || (sizeof(MpTrackInfo) != header.track_size))
+      {
+         GST_WARNING("Ignoring incompatible probe cache %s", p_probe_cache_path);
+      }
+      else
+      {
+         for (i = 0; (i < header.count) && ((offset + sizeof(record) + PROBE_INFO_FIXED_SIZE) <= length); i++)
+         {
+            p_entry = g_new0(ProbeCacheEntry, 1);
+
+            memcpy(&record, p_contents + offset, sizeof(record));
+            offset += sizeof(record);
+            memcpy(&p_entry->info, p_contents + offset, PROBE_INFO_FIXED_SIZE);
+            offset += PROBE_INFO_FIXED_SIZE;
+
+            if ((p_entry->info.n_tracks > MP_PROBE_MAX_TRACKS) ||
+                ((offset + (p_entry->info.n_tracks * sizeof(MpTrackInfo)) + record.path_len) > length))
+            {
+               GST_WARNING("Probe cache %s is truncated", p_probe_cache_path);
+               g_free(p_entry);
+               break;
+            }
+
+            memcpy(p_entry->info.tracks, p_contents + offset, p_entry->info.n_tracks * sizeof(MpTrackInfo));
+            offset += p_entry->info.n_tracks * sizeof(MpTrackInfo);
+
+            p_entry->mtime    = record.mtime;
+            p_entry->size     = record.size;
+            p_entry->is_media = record.is_media;
+
+            g_hash_table_replace(p_probe_cache, g_strndup(p_contents + offset, record.path_len), p_entry);
+            offset += record.path_len;
+         }
+      }
+
+      g_free(p_contents);
+   }
+
+   return loaded;
+}
+
+/**
+ * \brief Look a file up in the cache
+ *
+ * \param[in]  p_path     - file path
+ * \param[in]  p_stat     - current stat of the file
+ * \param[out] p_info     - cached info if found
+ * \param[out] p_is_media - cached result if found
+ *
+ * \return gboolean - TRUE if the cache has the file as it is now
+ * \author Jason Neitzert
+ */
+static gboolean probe_cache_lookup(const gchar *p_path, const GStatBuf *p_stat, MpMediaInfo *p_info, gboolean *p_is_media)
+{
+   ProbeCacheEntry *p_entry = NULL;
+   gboolean         found   = FALSE;
+
+   g_mutex_lock(&probe_cache_mutex);
+
+   if (p_probe_cache && (p_entry = g_hash_table_lookup(p_probe_cache, p_path)) &&
+       (p_entry->mtime == ((p_stat->st_mtim.tv_sec * G_GINT64_CONSTANT(1000000000)) + p_stat->st_mtim.tv_nsec)) &&
+       (p_entry->size == p_stat->st_size))
+   {
+      *p_info     = p_entry->info;
+      *p_is_media = p_entry->is_media;
+      found       = TRUE;
+   }
+
+   g_mutex_unlock(&probe_cache_mutex);
+
+   return found;
+}
+
+/**
+ * \brief Remember a probe result in the cache
+ * \details Makes the cache on first use, so it works in memory without a cache file.
+ *
+ * \param[in] p_path   - file path
+ * \param[in] p_stat   - stat of the file when probed
+ * \param[in] p_info   - probe result
+ * \param[in] is_media - TRUE if the file is media
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void probe_cache_store(const gchar *p_path, const GStatBuf *p_stat, const MpMediaInfo *p_info, gboolean is_media)
+{
+   ProbeCacheEntry *p_entry = NULL;
+
+   g_mutex_lock(&probe_cache_mutex);
+
+   if (!p_probe_cache)
+   {
+      p_probe_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+   }
+
+   p_entry           = g_new0(ProbeCacheEntry, 1);
+   p_entry->mtime    = (p_stat->st_mtim.tv_sec * G_GINT64_CONSTANT(1000000000)) + p_stat->st_mtim.tv_nsec;
+   p_entry->size     = p_stat->st_size;
+   p_entry->is_media = is_media;
+   p_entry->info     = *p_info;
+
+   g_hash_table_replace(p_probe_cache, g_strdup(p_path), p_entry);
+   probe_cache_dirty = TRUE;
+
+   g_mutex_unlock(&probe_cache_mutex);
+}
+
+/**
+ * \brief Add regular files under a directory to a list, recursing into subdirectories
+ * \details Symlinks are not followed so loops can't happen.
+ *
+ * \param[in] p_directory - directory to walk
+ * \param[in] p_files     - array of paths to add to
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void probe_collect_files(const gchar *p_directory, GPtrArray *p_files)
+{
+   GDir        *p_dir  = g_dir_open(p_directory, 0, NULL);
+   const gchar *p_name = NULL;
+   gchar       *p_path = NULL;
+   GStatBuf     stat_buf;
+
+   if (!p_dir)
+   {
+      GST_WARNING("Failed to open directory %s", p_directory);
+   }
+   else
+   {
+      while ((p_name = g_dir_read_name(p_dir)))
+      {
+         p_path = g_build_filename(p_directory, p_name, NULL);
+
+         if (0 != g_lstat(p_path, &stat_buf))
+         {
+            g_free(p_path);
+         }
+         else if (S_ISDIR(stat_buf.st_mode))
+         {
+            probe_collect_files(p_path, p_files);
+            g_free(p_path);
+         }
+         else if (S_ISREG(stat_buf.st_mode))
+         {
+            g_ptr_array_add(p_files, p_path);
+         }
+         else
+         {
+            g_free(p_path);
+         }
+      }
+
+      g_dir_close(p_dir);
+   }
+}
+
+/**
+ * \brief Thread pool worker of media_player_probe_scan, probes one file
+ *
+ * \param[in] p_data      - path of file
+ * \param[in] p_user_data - scan state
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void probe_scan_worker(gpointer p_data, gpointer p_user_data)
+{
+   ProbeScan   *p_scan = (ProbeScan*)p_user_data;
+   MpMediaInfo  info;
+
+   if (media_player_probe(p_data, &info))
+   {
+      g_atomic_int_inc(&p_scan->media_files);
+
+      if (p_scan->callback)
+      {
+         p_scan->callback(p_data, &info, p_scan->p_user_data);
+      }
+   }
+}
+
+/***************** Public Functions *************/
+
+/**
+ * \brief Find duration, container and tracks of a media file without playing it
+ * \details Answered from the cache if the file's mtime and size haven't
+ *          changed since it was last probed. Safe to call from any thread.
+ *
+ * \param[in]  p_path - local file path
+ * \param[out] p_info - what was found
+ *
+ * \return bool - true if the file is media
+ * \author Jason Neitzert
+ */
+bool media_player_probe(const char *p_path, MpMediaInfo *p_info)
+{
+   GStatBuf    stat_buf;
+   gboolean    is_media = FALSE;
+   ProbeResult result   = ePROBE_FAILED;
+
+   if (0 != g_stat(p_path, &stat_buf))
+   {
+      GST_WARNING("Failed to stat %s", p_path);
+   }
+   else if (!probe_cache_lookup(p_path, &stat_buf, p_info, &is_media))
+   {
+      result   = probe_discover(p_path, p_info);
+      is_media = (ePROBE_MEDIA == result);
+
+      /* Remember files that will never be media too, so they aren't probed again.
+         Failures that might not happen next time are left to be retried. */
+      if (ePROBE_FAILED != result)
+      {
+         probe_cache_store(p_path, &stat_buf, p_info, is_media);
+      }
+   }
+
+   return is_media;
+}
+
+/**
+ * \brief Probe every file under a directory, across all cores
+ * \details The callback is called from worker threads, possibly at the same
+ *          time, and only for files that are media. The cache is flushed
+ *          to disk when the scan is done.
+ *
+ * \param[in] p_directory - directory to scan recursively
+ * \param[in] callback    - called with each media file found, may be NULL
+ * \param[in] p_user_data - passed to callback
+ *
+ * \return unsigned int - number of media files found
+ * \author Jason Neitzert
+ */
+unsigned int media_player_probe_scan(const char *p_directory, MpProbeScanCallback callback, void *p_user_data)
+{
+   ProbeScan    scan    = {callback, p_user_data, 0};
+   GPtrArray   *p_files = g_ptr_array_new_with_free_func(g_free);
+   GThreadPool *p_pool  = NULL;
+   GError      *p_error = NULL;
+   guint        i       = 0;
+
+   probe_collect_files(p_directory, p_files);
+
+   if (!(p_pool = g_thread_pool_new(probe_scan_worker, &scan, g_get_num_processors(), TRUE, &p_error)))
+   {
+      GST_ERROR("Failed to create probe thread pool: %s", p_error->message);
+      g_error_free(p_error);
+   }
+   else
+   {
+      for (i = 0; i < p_files->len; i++)
+      {
+         (void)g_thread_pool_push(p_pool, g_ptr_array_index(p_files, i), NULL);
+      }
+
+      /* Waits for every file to be probed */
+      g_thread_pool_free(p_pool, FALSE, TRUE);
+
+      (void)media_player_probe_cache_flush();
+   }
+
+   g_ptr_array_unref(p_files);
+
+   return scan.media_files;
+}
+
+/**
+ * \brief Set the file probe results are cached in
+ * \details Replaces any cache in use, without saving it. Loads what the
+ *          file already holds.
+ *
+ * \param[in] p_cache_path - cache file, NULL to only cache in memory
+ *
+ * \return bool - true unless the cache file exists and couldn't be read
+ * \author Jason Neitzert
+ */
+bool media_player_probe_set_cache(const char *p_cache_path)
+{
+   gboolean loaded = TRUE;
+
+   g_mutex_lock(&probe_cache_mutex);
+
+   if (p_probe_cache)
+   {
+      g_hash_table_destroy(p_probe_cache);
+      p_probe_cache = NULL;
+   }
+
+   g_free(p_probe_cache_path);
+   p_probe_cache_path = g_strdup(p_cache_path);
+   probe_cache_dirty  = FALSE;
+
+   if (p_probe_cache_path)
+   {
+      p_probe_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+      loaded        = probe_cache_load_locked();
+   }
+
+   g_mutex_unlock(&probe_cache_mutex);
+
+   return loaded;
+}
+
+/**
+ * \brief Save the cache to its file if anything was probed since last save
+ * \details Written to a temporary file and renamed over the old one, so a
+ *          crash never leaves a partial cache. Nothing to do without a cache file.
+ *
+ * \return bool - true if the cache file is up to date
+ * \author Jason Neitzert
+ */
+bool media_player_probe_cache_flush()
+{
+   GByteArray       *p_contents = NULL;
+   GHashTableIter    iter;
+   gpointer          p_key      = NULL;
+   gpointer          p_value    = NULL;
+   ProbeCacheEntry  *p_entry    = NULL;
+   ProbeCacheHeader  header     = {PROBE_CACHE_MAGIC, PROBE_CACHE_VERSION, sizeof(MpTrackInfo), 0};
+   ProbeCacheRecord  record;
+   GError           *p_error    = NULL;
+   gboolean          saved      = TRUE;
+
+   g_mutex_lock(&probe_cache_mutex);
+
+   if (p_probe_cache && p_probe_cache_path && probe_cache_dirty)
+   {
+      header.count = g_hash_table_size(p_probe_cache);
+      p_contents   = g_byte_array_new();
+      g_byte_array_append(p_contents, (const guint8*)&header, sizeof(header));
+
+      g_hash_table_iter_init(&iter, p_probe_cache);
+      while (g_hash_table_iter_next(&iter, &p_key, &p_value))
+      {
+         p_entry = (ProbeCacheEntry*)p_value;
+
+         memset(&record, 0, sizeof(record));
+         record.path_len = strlen(p_key);
+         record.is_media = p_entry->is_media;
+         record.mtime    = p_entry->mtime;
+         record.size     = p_entry->size;
+
+         g_byte_array_append(p_contents, (const guint8*)&record, sizeof(record));
+         g_byte_array_append(p_contents, (const guint8*)&p_entry->info,
+                             PROBE_INFO_FIXED_SIZE + (p_entry->info.n_tracks * sizeof(MpTrackInfo)));
+         g_byte_array_append(p_contents, p_key, record.path_len);
+      }
+
+      if (!g_file_set_contents(p_probe_cache_path, (const gchar*)p_contents->data, p_contents->len, &p_error))
+      {
+         GST_ERROR("Failed to write probe cache: %s", p_error->message);
+         g_error_free(p_error);
+         saved = FALSE;
+      }
+      else
+      {
+         probe_cache_dirty = FALSE;
+      }
+
+      g_byte_array_unref(p_contents);
+   }
+
+   g_mutex_unlock(&probe_cache_mutex);
+
+   return saved;
+}
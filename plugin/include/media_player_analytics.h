@@ -0,0 +1,84 @@
+/**
+* \file      media_player_analytics.h
+* \details   Per frame luma analytics for the MediaPlayer plugin. Computes
+*            luma histograms, mean/variance and frame difference scores,
+*            and turns them into scene change/black/frozen frame events.
+* \author    Jason Neitzert
+* \date      10/19/2026
+* \Copyright Jason Neitzert
+*/
+
+#ifndef MEDIA_PLAYER_ANALYTICS_H
+#define MEDIA_PLAYER_ANALYTICS_H
+/***************** Includes *******************************************/
+#include <glib.h>
+
+/***************** Defines ********************************************/
+#define MEDIA_PLAYER_ANALYTICS_HISTOGRAM_BINS 256
+
+/* Only every Nth luma row is analysed. Plenty for frame level decisions and halves the cost */
+#define MEDIA_PLAYER_ANALYTICS_ROW_STEP       2
+
+/************************* Structures and Enums ***********************/
+/* Events analytics can raise for a frame. More than one may be set at once. */
+typedef enum
+{
+    eMPA_EVENT_NONE         = 0,
+    eMPA_EVENT_SCENE_CHANGE = 1 << 0,
+    eMPA_EVENT_BLACK_FRAME  = 1 << 1,
+    eMPA_EVENT_FROZEN_FRAME = 1 << 2
+} MediaPlayerAnalyticsEvent;
+
+/* Results for a single frame */
+typedef struct
+{
+    guint32 histogram[MEDIA_PLAYER_ANALYTICS_HISTOGRAM_BINS];
+    gdouble mean;
+    gdouble variance;
+
+    /* Mean absolute luma difference to previous frame, negative if there was none */
+    gdouble difference;
+} MediaPlayerFrameStats;
+
+/* Kernel implementations for one instruction set */
+typedef struct
+{
+    const gchar *p_name;
+    guint64 (*luma_sad)(const guint8 *p_plane, gint stride,
+                        const guint8 *p_previous, gint previous_stride,
+                        gint width, gint height);
+} MediaPlayerAnalyticsKernels;
+
+/* Analytics state for one video stream */
+typedef struct
+{
+    const MediaPlayerAnalyticsKernels *p_kernels;
+
+    /* Analysed rows of the previous frame, packed with stride == width */
+    guint8  *p_previous;
+    gint     width;
+    gint     height;
+    gboolean has_previous;
+
+    gboolean in_black;
+    guint    static_frames;
+} MediaPlayerAnalytics;
+
+/***************** Public Functions ***********************************/
+/* Scalar on every cpu, accumulates into p_histogram */
+void media_player_analytics_luma_histogram(const guint8 *p_plane, gint stride, gint width, gint height,
+                                           guint32 *p_histogram);
+
+const MediaPlayerAnalyticsKernels *media_player_analytics_kernels_scalar(void);
+const MediaPlayerAnalyticsKernels *media_player_analytics_kernels_sse4(void);
+const MediaPlayerAnalyticsKernels *media_player_analytics_kernels_avx2(void);
+const MediaPlayerAnalyticsKernels *media_player_analytics_kernels_best(void);
+
+void media_player_analytics_init(MediaPlayerAnalytics *p_analytics);
+void media_player_analytics_reset(MediaPlayerAnalytics *p_analytics);
+void media_player_analytics_clear(MediaPlayerAnalytics *p_analytics);
+MediaPlayerAnalyticsEvent media_player_analytics_process(MediaPlayerAnalytics *p_analytics,
+                                                         const guint8 *p_luma, gint stride,
+                                                         gint width, gint height,
+                                                         MediaPlayerFrameStats *p_stats);
+#endif
@@ -0,0 +1,41 @@
+/**
+* \file      media_player_arena.h
+* \details   Process wide arenas decoded video frames are carved from. Frame
+*            memory is reused across every player in the process and never
+*            handed back to the OS, so steady state playback does no large
+*            allocations and takes no page faults.
+* \author    Jason Neitzert
+* \date      10/19/2026
+* \Copyright Jason Neitzert
+*/
+
+#ifndef MEDIA_PLAYER_ARENA_H
+#define MEDIA_PLAYER_ARENA_H
+/***************** Includes *******************************************/
+#include <gst/gst.h>
+
+/***************** Defines ********************************************/
+#define MEDIA_PLAYER_ARENA_MEMORY_TYPE "MediaPlayerArenaMemory"
+
+/* Names the arenas are registered under, see gst_allocator_find */
+#define MEDIA_PLAYER_ARENA_NAME            "MediaPlayerArena"
+#define MEDIA_PLAYER_ARENA_HUGE_PAGES_NAME "MediaPlayerArenaHugePages"
+
+/* Arenas grow in chunks of this size, a multiple of the huge page size */
+#define MEDIA_PLAYER_ARENA_CHUNK_SIZE     (64 * 1024 * 1024)
+#define MEDIA_PLAYER_ARENA_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+/************************* Structures and Enums ***********************/
+/* Values of the mediaplayer "frame-arena" property */
+typedef enum
+{
+    MEDIA_PLAYER_ARENA_OFF,        /* Decoders use whatever the sink proposes */
+    MEDIA_PLAYER_ARENA_ON,         /* Frames come from the shared arena */
+    MEDIA_PLAYER_ARENA_HUGE_PAGES  /* Frames come from the shared huge page backed arena */
+} MediaPlayerArenaMode;
+
+/***************** Public Functions ***********************************/
+void media_player_arena_register(void);
+GstAllocator *media_player_arena_get(gboolean huge_pages);
+gboolean media_player_arena_propose_allocation(GstQuery *p_query, gboolean huge_pages);
+#endif
@@ -0,0 +1,41 @@
+/**
+* \file      media_player_shm_export.h
+* \details   Producer side of the shared memory frame ring. Decoded frames are
+*            published into a memfd backed ring that local consumer processes
+*            attach to through a Unix socket (see media_player_shm.h).
+*
+*            Ring slots are offered to upstream as a buffer pool in the
+*            ALLOCATION query, so decoders write frames straight into shared
+*            memory and publishing only hands the slot over. Frames that
+*            arrive in any other memory, from elements that refuse the pool,
+*            are copied into a free slot and counted.
+* \author    Jason Neitzert
+* \date      10/19/2026
+* \Copyright Jason Neitzert
+*/
+
+#ifndef MEDIA_PLAYER_SHM_EXPORT_H
+#define MEDIA_PLAYER_SHM_EXPORT_H
+/***************** Includes *******************************************/
+#include <gst/gst.h>
+#include "media_player_shm_protocol.h"
+
+/***************** Defines ********************************************/
+#define MEDIA_PLAYER_SHM_DEFAULT_SLOTS 4
+#define MEDIA_PLAYER_SHM_MIN_SLOTS     2
+
+#define MEDIA_PLAYER_SHM_MEMORY_TYPE "MediaPlayerShmMemory"
+
+/***************** Types **********************************************/
+typedef struct MediaPlayerShmExport MediaPlayerShmExport;
+
+/***************** Public Functions ***********************************/
+MediaPlayerShmExport *media_player_shm_export_new(const gchar *p_socket_path, guint slot_count);
+void media_player_shm_export_free(MediaPlayerShmExport *p_export);
+gboolean media_player_shm_export_set_caps(MediaPlayerShmExport *p_export, GstCaps *p_caps);
+gboolean media_player_shm_export_propose_allocation(MediaPlayerShmExport *p_export, GstQuery *p_query);
+gboolean media_player_shm_export_publish(MediaPlayerShmExport *p_export, GstBuffer *p_buffer);
+guint64 media_player_shm_export_get_published(MediaPlayerShmExport *p_export);
+guint64 media_player_shm_export_get_copied(MediaPlayerShmExport *p_export);
+guint64 media_player_shm_export_get_dropped(MediaPlayerShmExport *p_export);
+#endif
@@ -0,0 +1,80 @@
+/**
+* \file      media_player_shm_protocol.h
+* \details   Layout of the shared memory frame ring exported by the MediaPlayer
+*            plugin. Shared by the producer in the plugin and the consumer
+*            library, so it only depends on the C library.
+*
+*            The ring is a single memfd handed to consumers over a Unix socket
+*            with SCM_RIGHTS. It starts with MpShmRingHeader, followed by
+*            slot_count frames of slot_size bytes starting at slots_offset.
+*
+*            The producer hands each consumer an id along with the memfd, and
+*            consumers stay connected for as long as they are attached. A slot
+*            is owned by the producer while its sequence is 0. Consumers set
+*            their bit in leases before checking sequence and the producer
+*            clears sequence before checking leases, so a slot being read is
+*            never overwritten. When a consumer's connection hangs up, however
+*            it died, the producer clears its bit in every slot.
+* \author    Jason Neitzert
+* \date      10/19/2026
+* \Copyright Jason Neitzert
+*/
+
+#ifndef MEDIA_PLAYER_SHM_PROTOCOL_H
+#define MEDIA_PLAYER_SHM_PROTOCOL_H
+/***************** Includes *******************************************/
+#include <stdint.h>
+
+/***************** Defines ********************************************/
+#define MP_SHM_MAGIC         0x4d505348 /* "MPSH" */
+#define MP_SHM_VERSION       2
+#define MP_SHM_MAX_SLOTS     64
+#define MP_SHM_MAX_CONSUMERS 64 /* One bit each in MpShmSlot leases */
+#define MP_SHM_MAX_PLANES    4
+#define MP_SHM_FORMAT_LEN    16
+
+/* latest packs the frame sequence and its slot into one word so they update together */
+#define MP_SHM_LATEST_SLOT_BITS          8
+#define MP_SHM_LATEST_PACK(seq, slot)    (((uint64_t)(seq) << MP_SHM_LATEST_SLOT_BITS) | (slot))
+#define MP_SHM_LATEST_SEQUENCE(latest)   ((latest) >> MP_SHM_LATEST_SLOT_BITS)
+#define MP_SHM_LATEST_SLOT(latest)       ((uint32_t)((latest) & ((1 << MP_SHM_LATEST_SLOT_BITS) - 1)))
+
+/************************* Structures and Enums ***********************/
+/* Description of the frame held in one slot */
+typedef struct
+{
+    uint64_t sequence;  /* Frame number, 0 while the producer owns the slot */
+    uint64_t leases;    /* Bit per consumer id currently holding the slot */
+    uint32_t width;
+    uint32_t height;
+    uint32_t n_planes;
+    int64_t  pts;          /* Buffer timestamp in ns, -1 if none */
+    int64_t  publish_time; /* Producer CLOCK_MONOTONIC time of publish in ns */
+    uint64_t size;
+    uint32_t offsets[MP_SHM_MAX_PLANES];
+    uint32_t strides[MP_SHM_MAX_PLANES];
+    char     format[MP_SHM_FORMAT_LEN]; /* GStreamer video format name, eg "I420" */
+} MpShmSlot;
+
+/* Sent by the producer with the memfd as SCM_RIGHTS when a consumer connects */
+typedef struct
+{
+    uint32_t version;
+    uint32_t consumer; /* Id of the consumer, its bit in MpShmSlot leases */
+} MpShmHello;
+
+/* Header at the start of the memfd */
+typedef struct
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t closed;       /* Set once the producer stops publishing */
+    uint64_t slot_size;
+    uint64_t slots_offset;
+    uint64_t latest;       /* MP_SHM_LATEST_PACK of newest frame, 0 if none yet */
+    uint32_t frame_futex;  /* Bumped on every publish, consumers futex wait on it */
+    uint32_t reserved;
+    MpShmSlot slots[MP_SHM_MAX_SLOTS];
+} MpShmRingHeader;
+#endif
@@ -0,0 +1,236 @@
+/**
+* \file      media_player_snapshot.h
+* \details   Playback snapshot shared between the MediaPlayer plugin and api.
+*            The plugin writes position/duration/state into the snapshot from
+*            its streaming and message threads, and readers copy it out under
+*            a sequence lock so polling never touches the pipeline or blocks.
+* \author    Jason Neitzert
+* \date      10/19/2026
+* \Copyright Jason Neitzert
+*/
+
+#ifndef MEDIA_PLAYER_SNAPSHOT_H
+#define MEDIA_PLAYER_SNAPSHOT_H
+/***************** Includes *******************************************/
+#include <gst/gst.h>
+
+/************************* Structures and Enums ***********************/
+typedef struct
+{
+    /* Odd while a write is in progress, bumped twice per write */
+    gint         sequence;
+
+    GstClockTime position;
+    GstClockTime duration;
+    GstState     state;
+
+    /* Frames the video sink dropped as late. Plain counter outside the sequence lock */
+    guint64      dropped;
+
+    /* Serializes writers (streaming thread and message thread). Readers never take it. */
+    GMutex       write_mutex;
+} MediaPlayerSnapshot;
+
+/***************** Public Functions ***********************************/
+/**
+ * \brief Init a snapshot to its empty values
+ *
+ * \param[in] p_snapshot - pointer to snapshot
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static inline void media_player_snapshot_init(MediaPlayerSnapshot *p_snapshot)
+{
+    p_snapshot->sequence = 0;
+    p_snapshot->position = GST_CLOCK_TIME_NONE;
+    p_snapshot->duration = GST_CLOCK_TIME_NONE;
+    p_snapshot->state    = GST_STATE_NULL;
+    p_snapshot->dropped  = 0;
+    g_mutex_init(&p_snapshot->write_mutex);
+}
+
+/**
+ * \brief Free resources held by a snapshot
+ *
+ * \param[in] p_snapshot - pointer to snapshot
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static inline void media_player_snapshot_clear(MediaPlayerSnapshot *p_snapshot)
+{
+    g_mutex_clear(&p_snapshot->write_mutex);
+}
+
+/**
+ * \brief Start updating a snapshot. Must be paired with media_player_snapshot_write_end
+ *
+ * \param[in] p_snapshot - pointer to snapshot
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static inline void media_player_snapshot_write_begin(MediaPlayerSnapshot *p_snapshot)
+{
+    g_mutex_lock(&p_snapshot->write_mutex);
+    __atomic_store_n(&p_snapshot->sequence, p_snapshot->sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/**
+ * \brief Publish an update started with media_player_snapshot_write_begin
+ *
+ * \param[in] p_snapshot - pointer to snapshot
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static inline void media_player_snapshot_write_end(MediaPlayerSnapshot *p_snapshot)
+{
+    __atomic_store_n(&p_snapshot->sequence, p_snapshot->sequence + 1, __ATOMIC_RELEASE);
+    g_mutex_unlock(&p_snapshot->write_mutex);
+}
+
+/**
+ * \brief Update the position held by a snapshot
+ *
+ * \param[in] p_snapshot - pointer to snapshot
+ * \param[in] position   - new position in ns
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static inline void media_player_snapshot_set_position(MediaPlayerSnapshot *p_snapshot, GstClockTime position)
+{
+    media_player_snapshot_write_begin(p_snapshot);
+    __atomic_store_n(&p_snapshot->position, position, __ATOMIC_RELAXED);
+    media_player_snapshot_write_end(p_snapshot);
+}
+
+/**
+ * \brief Update the duration held by a snapshot
+ *
+ * \param[in] p_snapshot - pointer to snapshot
+ * \param[in] duration   - new duration in ns
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static inline void media_player_snapshot_set_duration(MediaPlayerSnapshot *p_snapshot, GstClockTime duration)
+{
+    media_player_snapshot_write_begin(p_snapshot);
+    __atomic_store_n(&p_snapshot->duration, duration, __ATOMIC_RELAXED);
+    media_player_snapshot_write_end(p_snapshot);
+}
+
+/**
+ * \brief Update the state held by a snapshot
+ *
+ * \param[in] p_snapshot - pointer to snapshot
+ * \param[in] state      - new state
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static inline void media_player_snapshot_set_state(MediaPlayerSnapshot *p_snapshot, GstState state)
+{
+    media_player_snapshot_write_begin(p_snapshot);
+    __atomic_store_n(&p_snapshot->state, state, __ATOMIC_RELAXED);
+    media_player_snapshot_write_end(p_snapshot);
+}
+
+/**
+ * \brief Put a snapshot back to its empty values
+ *
+ * \param[in] p_snapshot - pointer to snapshot
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static inline void media_player_snapshot_reset(MediaPlayerSnapshot *p_snapshot)
+{
+    media_player_snapshot_write_begin(p_snapshot);
+    __atomic_store_n(&p_snapshot->position, GST_CLOCK_TIME_NONE, __ATOMIC_RELAXED);
+    __atomic_store_n(&p_snapshot->duration, GST_CLOCK_TIME_NONE, __ATOMIC_RELAXED);
+    __atomic_store_n(&p_snapshot->state, GST_STATE_NULL, __ATOMIC_RELAXED);
+    media_player_snapshot_write_end(p_snapshot);
+
+    __atomic_store_n(&p_snapshot->dropped, 0, __ATOMIC_RELAXED);
+}
+
+/**
+ * \brief Count dropped frames
+ *
+ * \param[in] p_snapshot - pointer to snapshot
+ * \param[in] count      - frames dropped since last counted
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static inline void media_player_snapshot_add_dropped(MediaPlayerSnapshot *p_snapshot, guint64 count)
+{
+    __atomic_add_fetch(&p_snapshot->dropped, count, __ATOMIC_RELAXED);
+}
+
+/**
+ * \brief Get number of frames dropped
+ *
+ * \param[in] p_snapshot - pointer to snapshot
+ *
+ * \return guint64 - frames dropped since the player left NULL
+ * \author Jason Neitzert
+ */
+static inline guint64 media_player_snapshot_get_dropped(const MediaPlayerSnapshot *p_snapshot)
+{
+    return __atomic_load_n(&p_snapshot->dropped, __ATOMIC_RELAXED);
+}
+
+/**
+ * \brief Copy a consistent view of the snapshot. Never blocks on writers.
+ *
+ * \param[in]  p_snapshot   - pointer to snapshot
+ * \param[out] p_position   - position in ns, or GST_CLOCK_TIME_NONE. May be NULL
+ * \param[out] p_duration   - duration in ns, or GST_CLOCK_TIME_NONE. May be NULL
+ * \param[out] p_state      - current state of the player. May be NULL
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static inline void media_player_snapshot_read(const MediaPlayerSnapshot *p_snapshot,
+                                              GstClockTime *p_position,
+                                              GstClockTime *p_duration,
+                                              GstState     *p_state)
+{
+    gint         sequence = 0;
+    GstClockTime position = GST_CLOCK_TIME_NONE;
+    GstClockTime duration = GST_CLOCK_TIME_NONE;
+    GstState     state    = GST_STATE_NULL;
+
+    do
+    {
+        sequence = __atomic_load_n(&p_snapshot->sequence, __ATOMIC_ACQUIRE);
+
+        position = __atomic_load_n(&p_snapshot->position, __ATOMIC_RELAXED);
+        duration = __atomic_load_n(&p_snapshot->duration, __ATOMIC_RELAXED);
+        state    = __atomic_load_n(&p_snapshot->state, __ATOMIC_RELAXED);
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while ((sequence & 1) || (sequence != __atomic_load_n(&p_snapshot->sequence, __ATOMIC_RELAXED)));
+
+    if (p_position)
+    {
+        *p_position = position;
+    }
+
+    if (p_duration)
+    {
+        *p_duration = duration;
+    }
+
+    if (p_state)
+    {
+        *p_state = state;
+    }
+}
+#endif
@@ -0,0 +1,28 @@
+/**
+* \file      media_player_throttle.h
+* \details   Throttle levels the MediaPlayer plugin can be put in by the
+*            decode resource governor in the api, and how decode load is
+*            estimated for the governor.
+* \author    Jason Neitzert
+* \date      10/19/2026
+* \Copyright Jason Neitzert
+*/
+
+#ifndef MEDIA_PLAYER_THROTTLE_H
+#define MEDIA_PLAYER_THROTTLE_H
+/***************** Defines ********************************************/
+/* Decode load of a 1080p60 video, in cores. Loads of other streams scale by pixel rate. */
+#define MEDIA_PLAYER_REFERENCE_LOAD_PIXEL_RATE (1920.0 * 1080.0 * 60.0)
+
+/* Load assumed before the video format is known */
+#define MEDIA_PLAYER_DEFAULT_DECODE_LOAD       1.0
+
+/************************* Structures and Enums ***********************/
+/* Values of the mediaplayer "throttle" property, least throttled first */
+typedef enum
+{
+    MEDIA_PLAYER_THROTTLE_NONE,      /* Decode and render every frame */
+    MEDIA_PLAYER_THROTTLE_KEY_UNITS, /* Only decode key frames */
+    MEDIA_PLAYER_THROTTLE_PAUSED     /* Pipeline held paused */
+} MediaPlayerThrottle;
+#endif
@@ -0,0 +1,466 @@
+/**
+* \file      media_player_analytics.c
+* \details   Media Player frame analytics implementation. SAD kernels have
+*            SSE4.1 and AVX2 versions picked at runtime, with a scalar fallback.
+*            The histogram is scalar on every cpu.
+* \author    Jason Neitzert
+* \date      10/19/2026
+* \Copyright Jason Neitzert
+*/
+
+/***************** Includes ********************/
+#include <string.h>
+#include "media_player_analytics.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define MEDIA_PLAYER_ANALYTICS_X86 1
+#endif
+
+/***************** Defines *********************/
+/* Mean absolute difference above which a frame is considered a new scene */
+#define SCENE_CHANGE_DIFFERENCE  30.0
+
+/* Frame is black when it is both dark and flat */
+#define BLACK_FRAME_MEAN         24.0
+#define BLACK_FRAME_VARIANCE     16.0
+
+/* Frame is frozen once this many frames in a row barely differ */
+#define FROZEN_FRAME_DIFFERENCE  0.5
+#define FROZEN_FRAME_COUNT       30
+
+/************** Private Functions ****************/
+/**
+ * \brief Scalar sum of absolute luma differences between two planes
+ *
+ * \param[in] p_plane         - pointer to first luma row of current frame
+ * \param[in] stride          - bytes between rows of current frame
+ * \param[in] p_previous      - pointer to first luma row of previous frame
+ * \param[in] previous_stride - bytes between rows of previous frame
+ * \param[in] width           - pixels per row
+ * \param[in] height          - rows to process
+ *
+ * \return guint64 - sum of absolute differences
+ * \author Jason Neitzert
+ */
+static guint64 luma_sad_scalar(const guint8 *p_plane, gint stride,
+                               const guint8 *p_previous, gint previous_stride,
+                               gint width, gint height)
+{
+    const guint8 *p_row          = NULL;
+    const guint8 *p_previous_row = NULL;
+    guint64       sad            = 0;
+    guint32       row_sad        = 0;
+    gint          row            = 0;
+    gint          x              = 0;
+
+    for (row = 0; row < height; row++)
+    {
+        p_row          = p_plane + ((gsize)row * stride);
+        p_previous_row = p_previous + ((gsize)row * previous_stride);
+        row_sad        = 0;
+
+        for (x = 0; x < width; x++)
+        {
+            row_sad += (guint32)ABS((gint)p_row[x] - (gint)p_previous_row[x]);
+        }
+
+        sad += row_sad;
+    }
+
+    return sad;
+}
+
+#ifdef MEDIA_PLAYER_ANALYTICS_X86
+/**
+ * \brief SSE4.1 sum of absolute luma differences between two planes
+ *
+ * \param[in] p_plane         - pointer to first luma row of current frame
+ * \param[in] stride          - bytes between rows of current frame
+ * \param[in] p_previous      - pointer to first luma row of previous frame
+ * \param[in] previous_stride - bytes between rows of previous frame
+ * \param[in] width           - pixels per row
+ * \param[in] height          - rows to process
+ *
+ * \return guint64 - sum of absolute differences
+ * \author Jason Neitzert
+ */
+__attribute__((target("sse4.1")))
+static guint64 luma_sad_sse4(const guint8 *p_plane, gint stride,
+                             const guint8 *p_previous, gint previous_stride,
+                             gint width, gint height)
+{
+    const guint8 *p_row          = NULL;
+    const guint8 *p_previous_row = NULL;
+    __m128i       sum            = _mm_setzero_si128();
+    guint64       sad            = 0;
+    gint          row            = 0;
+    gint          x              = 0;
+
+    for (row = 0; row < height; row++)
+    {
+        p_row          = p_plane + ((gsize)row * stride);
+        p_previous_row = p_previous + ((gsize)row * previous_stride);
+
+        for (x = 0; (x + 16) <= width; x += 16)
+        {
+            sum = _mm_add_epi64(sum, _mm_sad_epu8(_mm_loadu_si128((const __m128i*)(p_row + x)),
+                                                  _mm_loadu_si128((const __m128i*)(p_previous_row + x))));
+        }
+
+        for (; x < width; x++)
+        {
+            sad += (guint64)ABS((gint)p_row[x] - (gint)p_previous_row[x]);
+        }
+    }
+
+    return sad + (guint64)_mm_extract_epi64(sum, 0) + (guint64)_mm_extract_epi64(sum, 1);
+}
+
+/**
+ * \brief AVX2 sum of absolute luma differences between two planes
+ *
+ * \param[in] p_plane         - pointer to first luma row of current frame
+ * \param[in] stride          - bytes between rows of current frame
+ * \param[in] p_previous      - pointer to first luma row of previous frame
+ * \param[in] previous_stride - bytes between rows of previous frame
+ * \param[in] width           - pixels per row
+ * \param[in] height          - rows to process
+ *
+ * \return guint64 - sum of absolute differences
+ * \author Jason Neitzert
+ */
+__attribute__((target("avx2")))
+static guint64 luma_sad_avx2(const guint8 *p_plane, gint stride,
+                             const guint8 *p_previous, gint previous_stride,
+                             gint width, gint height)
+{
+    const guint8 *p_row          = NULL;
+    const guint8 *p_previous_row = NULL;
+    __m256i       sum_a          = _mm256_setzero_si256();
+    __m256i       sum_b          = _mm256_setzero_si256();
+    __m128i       sum            = _mm_setzero_si128();
+    guint64       sad            = 0;
+    gint          row            = 0;
+    gint          x              = 0;
+
+    for (row = 0; row < height; row++)
+    {
+        p_row          = p_plane + ((gsize)row * stride);
+        p_previous_row = p_previous + ((gsize)row * previous_stride);
+
+        /* Two accumulators to keep both load ports busy */
+        for (x = 0; (x + 64) <= width; x += 64)
+        {
+            sum_a = _mm256_add_epi64(sum_a, _mm256_sad_epu8(_mm256_loadu_si256((const __m256i*)(p_row + x)),
+                                                            _mm256_loadu_si256((const __m256i*)(p_previous_row + x))));
+            sum_b = _mm256_add_epi64(sum_b, _mm256_sad_epu8(_mm256_loadu_si256((const __m256i*)(p_row + x + 32)),
+                                                            _mm256_loadu_si256((const __m256i*)(p_previous_row + x + 32))));
+        }
+
+        for (; (x + 32) <= width; x += 32)
+        {
+            sum_a = _mm256_add_epi64(sum_a, _mm256_sad_epu8(_mm256_loadu_si256((const __m256i*)(p_row + x)),
+                                                            _mm256_loadu_si256((const __m256i*)(p_previous_row + x))));
+        }
+
+        for (; x < width; x++)
+        {
+            sad += (guint64)ABS((gint)p_row[x] - (gint)p_previous_row[x]);
+        }
+    }
+
+    sum_a = _mm256_add_epi64(sum_a, sum_b);
+    sum   = _mm_add_epi64(_mm256_castsi256_si128(sum_a), _mm256_extracti128_si256(sum_a, 1));
+
+    return sad + (guint64)_mm_extract_epi64(sum, 0) + (guint64)_mm_extract_epi64(sum, 1);
+}
+#endif
+
+/***************** Private Global Variables **************/
+static const MediaPlayerAnalyticsKernels scalar_kernels =
+{
+    "scalar", luma_sad_scalar
+};
+
+#ifdef MEDIA_PLAYER_ANALYTICS_X86
+static const MediaPlayerAnalyticsKernels sse4_kernels =
+{
+    "sse4.1", luma_sad_sse4
+};
+
+static const MediaPlayerAnalyticsKernels avx2_kernels =
+{
+    "avx2", luma_sad_avx2
+};
+#endif
+
+/***************** Public Functions *************/
+/**
+ * \brief Luma histogram
+ * \details Counts into four separate tables so repeated values in a row
+ *          don't serialize on the same counter, then merges them. x86 has
+ *          no scatter increment worth using here, so there is no SIMD version.
+ *
+ * \param[in]  p_plane     - pointer to first luma row
+ * \param[in]  stride      - bytes between rows
+ * \param[in]  width       - pixels per row
+ * \param[in]  height      - rows to process
+ * \param[out] p_histogram - histogram to accumulate into
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+void media_player_analytics_luma_histogram(const guint8 *p_plane, gint stride, gint width, gint height,
+                                           guint32 *p_histogram)
+{
+    guint32       banks[4][MEDIA_PLAYER_ANALYTICS_HISTOGRAM_BINS];
+    const guint8 *p_row = NULL;
+    gint          row   = 0;
+    gint          x     = 0;
+    gint          bin   = 0;
+
+    memset(banks, 0, sizeof(banks));
+
+    for (row = 0; row < height; row++)
+    {
+        p_row = p_plane + ((gsize)row * stride);
+
+        for (x = 0; (x + 4) <= width; x += 4)
+        {
+            banks[0][p_row[x]]++;
+            banks[1][p_row[x + 1]]++;
+            banks[2][p_row[x + 2]]++;
+            banks[3][p_row[x + 3]]++;
+        }
+
+        for (; x < width; x++)
+        {
+            banks[0][p_row[x]]++;
+        }
+    }
+
+    for (bin = 0; bin < MEDIA_PLAYER_ANALYTICS_HISTOGRAM_BINS; bin++)
+    {
+        p_histogram[bin] += banks[0][bin] + banks[1][bin] + banks[2][bin] + banks[3][bin];
+    }
+}
+
+/**
+ * \brief Get the scalar kernels
+ *
+ * \return const MediaPlayerAnalyticsKernels* - scalar kernels, always available
+ * \author Jason Neitzert
+ */
+const MediaPlayerAnalyticsKernels *media_player_analytics_kernels_scalar(void)
+{
+    return &scalar_kernels;
+}
+
+/**
+ * \brief Get the SSE4.1 kernels
+ *
+ * \return const MediaPlayerAnalyticsKernels* - SSE4.1 kernels, NULL if cpu doesn't support them
+ * \author Jason Neitzert
+ */
+const MediaPlayerAnalyticsKernels *media_player_analytics_kernels_sse4(void)
+{
+    const MediaPlayerAnalyticsKernels *p_kernels = NULL;
+
+#ifdef MEDIA_PLAYER_ANALYTICS_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse4.1"))
+    {
+        p_kernels = &sse4_kernels;
+    }
+#endif
+
+    return p_kernels;
+}
+
+/**
+ * \brief Get the AVX2 kernels
+ *
+ * \return const MediaPlayerAnalyticsKernels* - AVX2 kernels, NULL if cpu doesn't support them
+ * \author Jason Neitzert
+ */
+const MediaPlayerAnalyticsKernels *media_player_analytics_kernels_avx2(void)
+{
+    const MediaPlayerAnalyticsKernels *p_kernels = NULL;
+
+#ifdef MEDIA_PLAYER_ANALYTICS_X86
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        p_kernels = &avx2_kernels;
+    }
+#endif
+
+    return p_kernels;
+}
+
+/**
+ * \brief Get the fastest kernels the cpu supports
+ *
+ * \return const MediaPlayerAnalyticsKernels* - kernels to use
+ * \author Jason Neitzert
+ */
+const MediaPlayerAnalyticsKernels *media_player_analytics_kernels_best(void)
+{
+    const MediaPlayerAnalyticsKernels *p_kernels = NULL;
+
+    if (!(p_kernels = media_player_analytics_kernels_avx2()) &&
+        !(p_kernels = media_player_analytics_kernels_sse4()))
+    {
+        p_kernels = media_player_analytics_kernels_scalar();
+    }
+
+    return p_kernels;
+}
+
+/**
+ * \brief Init analytics state for a stream
+ *
+ * \param[in] p_analytics - pointer to analytics state
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+void media_player_analytics_init(MediaPlayerAnalytics *p_analytics)
+{
+    memset(p_analytics, 0, sizeof(*p_analytics));
+    p_analytics->p_kernels = media_player_analytics_kernels_best();
+}
+
+/**
+ * \brief Forget history, used when stream is flushed or its format changes
+ *
+ * \param[in] p_analytics - pointer to analytics state
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+void media_player_analytics_reset(MediaPlayerAnalytics *p_analytics)
+{
+    p_analytics->has_previous  = FALSE;
+    p_analytics->in_black      = FALSE;
+    p_analytics->static_frames = 0;
+}
+
+/**
+ * \brief Free resources held by analytics state
+ *
+ * \param[in] p_analytics - pointer to analytics state
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+void media_player_analytics_clear(MediaPlayerAnalytics *p_analytics)
+{
+    g_free(p_analytics->p_previous);
+    p_analytics->p_previous = NULL;
+    p_analytics->width      = 0;
+    p_analytics->height     = 0;
+    media_player_analytics_reset(p_analytics);
+}
+
+/**
+ * \brief Analyse the luma plane of one frame
+ *
+ * \param[in]  p_analytics - pointer to analytics state
+ * \param[in]  p_luma      - pointer to first luma row
+ * \param[in]  stride      - bytes between luma rows
+ * \param[in]  width       - luma width in pixels
+ * \param[in]  height      - luma height in rows
+ * \param[out] p_stats     - stats computed for the frame
+ *
+ * \return MediaPlayerAnalyticsEvent - events raised by this frame
+ * \author Jason Neitzert
+ */
+MediaPlayerAnalyticsEvent media_player_analytics_process(MediaPlayerAnalytics *p_analytics,
+                                                         const guint8 *p_luma, gint stride,
+                                                         gint width, gint height,
+                                                         MediaPlayerFrameStats *p_stats)
+{
+    MediaPlayerAnalyticsEvent events     = eMPA_EVENT_NONE;
+    gint                      row_stride = stride * MEDIA_PLAYER_ANALYTICS_ROW_STEP;
+    gint                      rows       = (height + MEDIA_PLAYER_ANALYTICS_ROW_STEP - 1) / MEDIA_PLAYER_ANALYTICS_ROW_STEP;
+    guint64                   samples    = (guint64)rows * width;
+    guint64                   sum        = 0;
+    guint64                   sum_square = 0;
+    gboolean                  black      = FALSE;
+    gint                      row        = 0;
+    gint                      bin        = 0;
+
+    memset(p_stats, 0, sizeof(*p_stats));
+    p_stats->difference = -1.0;
+
+    if (samples)
+    {
+        /* Mean and variance fall straight out of the histogram, no second pass needed */
+        media_player_analytics_luma_histogram(p_luma, row_stride, width, rows, p_stats->histogram);
+
+        for (bin = 0; bin < MEDIA_PLAYER_ANALYTICS_HISTOGRAM_BINS; bin++)
+        {
+            sum        += (guint64)p_stats->histogram[bin] * bin;
+            sum_square += (guint64)p_stats->histogram[bin] * bin * bin;
+        }
+
+        p_stats->mean     = (gdouble)sum / samples;
+        p_stats->variance = ((gdouble)sum_square / samples) - (p_stats->mean * p_stats->mean);
+
+        if ((p_analytics->width != width) || (p_analytics->height != rows))
+        {
+            g_free(p_analytics->p_previous);
+            p_analytics->p_previous   = g_malloc((gsize)rows * width);
+            p_analytics->width        = width;
+            p_analytics->height       = rows;
+            p_analytics->has_previous = FALSE;
+        }
+        else if (p_analytics->has_previous)
+        {
+            p_stats->difference = (gdouble)p_analytics->p_kernels->luma_sad(p_luma, row_stride,
+                                                                             p_analytics->p_previous, width,
+                                                                             width, rows) / samples;
+        }
+
+        for (row = 0; row < rows; row++)
+        {
+            memcpy(p_analytics->p_previous + ((gsize)row * width), p_luma + ((gsize)row * row_stride), width);
+        }
+        p_analytics->has_previous = TRUE;
+
+        /* Only report black on the first frame of a black run */
+        black = (p_stats->mean < BLACK_FRAME_MEAN) && (p_stats->variance < BLACK_FRAME_VARIANCE);
+        if (black && !p_analytics->in_black)
+        {
+            events |= eMPA_EVENT_BLACK_FRAME;
+        }
+        p_analytics->in_black = black;
+
+        if (p_stats->difference >= 0.0)
+        {
+            if (p_stats->difference > SCENE_CHANGE_DIFFERENCE)
+            {
+                events |= eMPA_EVENT_SCENE_CHANGE;
+            }
+
+            /* Only report frozen once per run of unchanging frames */
+            if (p_stats->difference < FROZEN_FRAME_DIFFERENCE)
+            {
+                if (++p_analytics->static_frames == FROZEN_FRAME_COUNT)
+                {
+                    events |= eMPA_EVENT_FROZEN_FRAME;
+                }
+            }
+            else
+            {
+                p_analytics->static_frames = 0;
+            }
+        }
+    }
+
+    return events;
+}
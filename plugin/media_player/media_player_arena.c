@@ -0,0 +1,588 @@
+/**
+* \file      media_player_arena.c
+* \details   Media Player frame arena implementation. Each arena is a
+*            GstAllocator handing out page aligned blocks carved from large
+*            mmap'd chunks. Freed blocks go on a free list per block size and
+*            are handed out again, chunks are never unmapped. Both arenas
+*            are registered by name so their counters can be read with
+*            gst_allocator_find.
+* \author    Jason Neitzert
+* \date      10/19/2026
+* \Copyright Jason Neitzert
+*/
+
+/***************** Includes ********************/
+#define _GNU_SOURCE
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <gst/video/video.h>
+#include "media_player_arena.h"
+
+/***************** Defines *********************/
+#define ARENA_PAGE_SIZE 4096
+
+#define ARENA_ROUND_UP(value, multiple) ((((value) + (multiple) - 1) / (multiple)) * (multiple))
+
+/***************** Structures ****************************/
+/* Arena counters, readable as properties */
+enum
+{
+    PROP_0,
+    PROP_ALLOCATIONS,
+    PROP_REUSED,
+    PROP_CHUNKS,
+    PROP_HUGETLB_CHUNKS,
+    PROP_MAPPED
+};
+
+typedef struct
+{
+    GstAllocator parent;
+
+    gboolean     huge_pages;
+
+    /* Protects everything below */
+    GMutex       mutex;
+    GHashTable  *p_free_blocks;   /* Block size -> first free block, free blocks link through their first bytes */
+    guint8      *p_chunk_next;    /* Next unused byte of the newest chunk */
+    gsize        chunk_remaining;
+    gsize        mapped;
+    guint64      allocations;    /* Blocks handed out */
+    guint64      reused;         /* Of those, blocks that came off a free list */
+    guint        chunks;
+    guint        hugetlb_chunks; /* Chunks of explicit huge pages, the rest fell back to normal pages */
+} MediaPlayerArena;
+
+typedef struct
+{
+    GstAllocatorClass parent_class;
+} MediaPlayerArenaClass;
+
+typedef struct
+{
+    GstMemory  mem;
+    guint8    *p_data;
+    gsize      block_size; /* 0 for memory shared from another, which doesn't own the block */
+} MediaPlayerArenaMemory;
+
+/************** Private Functions ****************/
+GType media_player_arena_get_type(void);
+G_DEFINE_TYPE(MediaPlayerArena, media_player_arena, GST_TYPE_ALLOCATOR)
+
+/**
+ * \brief Map a new chunk for the arena to carve blocks from
+ * \details Huge page arenas try explicit huge pages first and fall back to
+ *          asking for transparent huge pages.
+ *
+ * \param[in] p_arena    - pointer to arena
+ * \param[in] chunk_size - bytes to map
+ *
+ * \return guint8* - the chunk, NULL on failure
+ * \author Jason Neitzert
+ */
+static guint8 *media_player_arena_map_chunk(MediaPlayerArena *p_arena, gsize chunk_size)
+{
+    guint8 *p_chunk = MAP_FAILED;
+
+    if (p_arena->huge_pages)
+    {
+        p_chunk = mmap(NULL, chunk_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if (MAP_FAILED != p_chunk)
+        {
+            p_arena->hugetlb_chunks++;
+        }
+    }
+
+    if (MAP_FAILED == p_chunk)
+    {
+        p_chunk = mmap(NULL, chunk_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if ((MAP_FAILED != p_chunk) && p_arena->huge_pages)
+        {
+            (void)madvise(p_chunk, chunk_size, MADV_HUGEPAGE);
+        }
+    }
+
+    if (MAP_FAILED == p_chunk)
+    {
+        GST_ERROR("Failed to map %" G_GSIZE_FORMAT " byte arena chunk: %s", chunk_size, g_strerror(errno));
+        p_chunk = NULL;
+    }
+    else
+    {
+        p_arena->mapped += chunk_size;
+        p_arena->chunks++;
+    }
+
+    return p_chunk;
+}
+
+/**
+ * \brief Get a block from the arena, reusing a freed one of the same size if there is one
+ *
+ * \param[in] p_arena    - pointer to arena
+ * \param[in] block_size - page multiple size of block
+ *
+ * \return guint8* - the block, NULL on failure
+ * \author Jason Neitzert
+ */
+static guint8 *media_player_arena_get_block(MediaPlayerArena *p_arena, gsize block_size)
+{
+    guint8 *p_block    = NULL;
+    gsize   chunk_size = 0;
+
+    g_mutex_lock(&p_arena->mutex);
+
+    if ((p_block = g_hash_table_lookup(p_arena->p_free_blocks, GSIZE_TO_POINTER(block_size))))
+    {
+        g_hash_table_insert(p_arena->p_free_blocks, GSIZE_TO_POINTER(block_size), *(gpointer*)p_block);
+        p_arena->reused++;
+    }
+    else
+    {
+        /* What is left of the old chunk is abandoned. Frames of a stream are all
+           one size so this is at most one frame per chunk. */
+        if (p_arena->chunk_remaining < block_size)
+        {
+            chunk_size = MAX(MEDIA_PLAYER_ARENA_CHUNK_SIZE, ARENA_ROUND_UP(block_size, MEDIA_PLAYER_ARENA_HUGE_PAGE_SIZE));
+
+            if ((p_arena->p_chunk_next = media_player_arena_map_chunk(p_arena, chunk_size)))
+            {
+                p_arena->chunk_remaining = chunk_size;
+            }
+            else
+            {
+                p_arena->chunk_remaining = 0;
+            }
+        }
+
+        if (p_arena->chunk_remaining >= block_size)
+        {
+            p_block                   = p_arena->p_chunk_next;
+            p_arena->p_chunk_next    += block_size;
+            p_arena->chunk_remaining -= block_size;
+        }
+    }
+
+    if (p_block)
+    {
+        p_arena->allocations++;
+    }
+
+    g_mutex_unlock(&p_arena->mutex);
+
+    return p_block;
+}
+
+/**
+ * \brief Put a block on the free list for its size
+ *
+ * \param[in] p_arena    - pointer to arena
+ * \param[in] p_block    - block from media_player_arena_get_block
+ * \param[in] block_size - size block was got with
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void media_player_arena_put_block(MediaPlayerArena *p_arena, guint8 *p_block, gsize block_size)
+{
+    g_mutex_lock(&p_arena->mutex);
+    *(gpointer*)p_block = g_hash_table_lookup(p_arena->p_free_blocks, GSIZE_TO_POINTER(block_size));
+    g_hash_table_insert(p_arena->p_free_blocks, GSIZE_TO_POINTER(block_size), p_block);
+    g_mutex_unlock(&p_arena->mutex);
+}
+
+/**
+ * \brief GstAllocator alloc for the arena
+ *
+ * \param[in] p_allocator - the arena
+ * \param[in] size        - usable size wanted
+ * \param[in] p_params    - prefix, padding, alignment and flags wanted
+ *
+ * \return GstMemory* - the memory, NULL on failure
+ * \author Jason Neitzert
+ */
+static GstMemory *media_player_arena_alloc(GstAllocator *p_allocator, gsize size, GstAllocationParams *p_params)
+{
+    MediaPlayerArena       *p_arena    = (MediaPlayerArena*)p_allocator;
+    MediaPlayerArenaMemory *p_memory   = NULL;
+    gsize                   maxsize    = size + p_params->prefix + p_params->padding;
+    gsize                   block_size = ARENA_ROUND_UP(maxsize, ARENA_PAGE_SIZE);
+    guint8                 *p_block    = NULL;
+
+    /* Blocks are page aligned, anything stricter goes to the system */
+    if (p_params->align >= ARENA_PAGE_SIZE)
+    {
+        GST_WARNING("Arena can't align to %" G_GSIZE_FORMAT ", using system memory", p_params->align + 1);
+        p_memory = (MediaPlayerArenaMemory*)gst_allocator_alloc(NULL, size, p_params);
+    }
+    else if ((p_block = media_player_arena_get_block(p_arena, block_size)))
+    {
+        p_memory             = g_slice_new(MediaPlayerArenaMemory);
+        p_memory->p_data     = p_block;
+        p_memory->block_size = block_size;
+
+        gst_memory_init(GST_MEMORY_CAST(p_memory), p_params->flags, p_allocator, NULL, maxsize,
+                        p_params->align, p_params->prefix, size);
+
+        if (p_params->prefix && (p_params->flags & GST_MEMORY_FLAG_ZERO_PREFIXED))
+        {
+            memset(p_block, 0, p_params->prefix);
+        }
+
+        if (p_params->padding && (p_params->flags & GST_MEMORY_FLAG_ZERO_PADDED))
+        {
+            memset(p_block + p_params->prefix + size, 0, p_params->padding);
+        }
+    }
+
+    return GST_MEMORY_CAST(p_memory);
+}
+
+/**
+ * \brief GstAllocator free for the arena, returns the block to the arena
+ *
+ * \param[in] p_allocator - the arena
+ * \param[in] p_mem       - memory from media_player_arena_alloc or share
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void media_player_arena_free(GstAllocator *p_allocator, GstMemory *p_mem)
+{
+    MediaPlayerArenaMemory *p_memory = (MediaPlayerArenaMemory*)p_mem;
+
+    if (p_memory->block_size)
+    {
+        media_player_arena_put_block((MediaPlayerArena*)p_allocator, p_memory->p_data, p_memory->block_size);
+    }
+
+    g_slice_free(MediaPlayerArenaMemory, p_memory);
+}
+
+/**
+ * \brief Map arena memory, it is always mapped
+ *
+ * \param[in] p_mem   - memory to map
+ * \param[in] maxsize - size to map
+ * \param[in] flags   - map flags
+ *
+ * \return gpointer - start of memory
+ * \author Jason Neitzert
+ */
+static gpointer media_player_arena_mem_map(GstMemory *p_mem, gsize maxsize, GstMapFlags flags)
+{
+    return ((MediaPlayerArenaMemory*)p_mem)->p_data;
+}
+
+/**
+ * \brief Unmap arena memory
+ *
+ * \param[in] p_mem - memory to unmap
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void media_player_arena_mem_unmap(GstMemory *p_mem)
+{
+}
+
+/**
+ * \brief Share part of arena memory without copying
+ *
+ * \param[in] p_mem  - memory to share
+ * \param[in] offset - offset into p_mem to start at
+ * \param[in] size   - size to share, -1 for the rest of p_mem
+ *
+ * \return GstMemory* - memory holding a ref on the memory owning the block
+ * \author Jason Neitzert
+ */
+static GstMemory *media_player_arena_mem_share(GstMemory *p_mem, gssize offset, gssize size)
+{
+    MediaPlayerArenaMemory *p_memory = (MediaPlayerArenaMemory*)p_mem;
+    MediaPlayerArenaMemory *p_shared = g_slice_new(MediaPlayerArenaMemory);
+    GstMemory              *p_parent = p_mem->parent ? p_mem->parent : p_mem;
+
+    if (-1 == size)
+    {
+        size = p_mem->size - offset;
+    }
+
+    p_shared->p_data     = p_memory->p_data;
+    p_shared->block_size = 0;
+
+    gst_memory_init(GST_MEMORY_CAST(p_shared), GST_MINI_OBJECT_FLAGS(p_parent) | GST_MINI_OBJECT_FLAG_LOCK_READONLY,
+                    p_mem->allocator, p_parent, p_mem->maxsize, p_mem->align, p_mem->offset + offset, size);
+
+    return GST_MEMORY_CAST(p_shared);
+}
+
+/**
+ * \brief Get Property Function for the arena allocator
+ *
+ * \param[in]  p_object - pointer to arena object
+ * \param[in]  prop_id  - id of property to get
+ * \param[out] p_value  - value of property
+ * \param[in]  p_pspec  - property spec
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void media_player_arena_get_property(GObject *p_object, guint prop_id, GValue *p_value, GParamSpec *p_pspec)
+{
+    MediaPlayerArena *p_arena = (MediaPlayerArena*)p_object;
+
+    g_mutex_lock(&p_arena->mutex);
+
+    switch (prop_id)
+    {
+        case PROP_ALLOCATIONS:
+        {
+            g_value_set_uint64(p_value, p_arena->allocations);
+            break;
+        }
+        case PROP_REUSED:
+        {
+            g_value_set_uint64(p_value, p_arena->reused);
+            break;
+        }
+        case PROP_CHUNKS:
+        {
+            g_value_set_uint(p_value, p_arena->chunks);
+            break;
+        }
+        case PROP_HUGETLB_CHUNKS:
+        {
+            g_value_set_uint(p_value, p_arena->hugetlb_chunks);
+            break;
+        }
+        case PROP_MAPPED:
+        {
+            g_value_set_uint64(p_value, p_arena->mapped);
+            break;
+        }
+        default:
+        {
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(p_object, prop_id, p_pspec);
+            break;
+        }
+    }
+
+    g_mutex_unlock(&p_arena->mutex);
+}
+
+/**
+ * \brief Class init for the arena allocator
+ *
+ * \param[in] p_klass - pointer to class structure
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void media_player_arena_class_init(MediaPlayerArenaClass *p_klass)
+{
+    GstAllocatorClass *p_allocator_class = (GstAllocatorClass*)p_klass;
+    GObjectClass      *p_object_class    = (GObjectClass*)p_klass;
+
+    p_allocator_class->alloc     = media_player_arena_alloc;
+    p_allocator_class->free      = media_player_arena_free;
+    p_object_class->get_property = media_player_arena_get_property;
+
+    g_object_class_install_property(p_object_class, PROP_ALLOCATIONS,
+                                    g_param_spec_uint64("allocations", "Allocations",
+                                                        "Blocks handed out by the arena",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(p_object_class, PROP_REUSED,
+                                    g_param_spec_uint64("reused", "Reused",
+                                                        "Blocks handed out again after being freed",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(p_object_class, PROP_CHUNKS,
+                                    g_param_spec_uint("chunks", "Chunks",
+                                                      "Chunks mapped by the arena",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(p_object_class, PROP_HUGETLB_CHUNKS,
+                                    g_param_spec_uint("hugetlb-chunks", "HugeTLB Chunks",
+                                                      "Chunks mapped from explicit huge pages, others fell back to normal pages",
+                                                      0, G_MAXUINT, 0,
+                                                      G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(p_object_class, PROP_MAPPED,
+                                    g_param_spec_uint64("mapped", "Mapped",
+                                                        "Bytes mapped by the arena",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+}
+
+/**
+ * \brief Instance init for the arena allocator
+ *
+ * \param[in] p_arena - pointer to instance structure
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void media_player_arena_init(MediaPlayerArena *p_arena)
+{
+    GstAllocator *p_allocator = (GstAllocator*)p_arena;
+
+    p_allocator->mem_type  = MEDIA_PLAYER_ARENA_MEMORY_TYPE;
+    p_allocator->mem_map   = media_player_arena_mem_map;
+    p_allocator->mem_unmap = media_player_arena_mem_unmap;
+    p_allocator->mem_share = media_player_arena_mem_share;
+
+    g_mutex_init(&p_arena->mutex);
+    p_arena->p_free_blocks = g_hash_table_new(g_direct_hash, g_direct_equal);
+}
+
+/**
+ * \brief Check if a pool from an allocation query only gives system memory
+ *
+ * \param[in] p_pool      - pool from the query, may be NULL
+ * \param[in] p_allocator - first allocator from the query, may be NULL
+ *
+ * \return gboolean - TRUE if replacing them with the arena loses nothing
+ * \author Jason Neitzert
+ */
+static gboolean media_player_arena_is_system_memory(GstBufferPool *p_pool, GstAllocator *p_allocator)
+{
+    return (!p_pool || (GST_TYPE_BUFFER_POOL == G_OBJECT_TYPE(p_pool)) ||
+                       (GST_TYPE_VIDEO_BUFFER_POOL == G_OBJECT_TYPE(p_pool))) &&
+           (!p_allocator || !g_strcmp0(p_allocator->mem_type, GST_ALLOCATOR_SYSMEM));
+}
+
+/***************** Public Functions *************/
+
+/**
+ * \brief Create and register the process wide frame arenas
+ * \details Called once when the plugin loads. Nothing is mapped until a
+ *          frame is allocated, so an arena no player uses costs nothing.
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+void media_player_arena_register(void)
+{
+    GstAllocator *p_arena = NULL;
+
+    /* Registering takes the ref, allocators are never unregistered */
+    p_arena = gst_object_ref_sink(g_object_new(media_player_arena_get_type(), NULL));
+    gst_allocator_register(MEDIA_PLAYER_ARENA_NAME, p_arena);
+
+    p_arena = gst_object_ref_sink(g_object_new(media_player_arena_get_type(), NULL));
+    ((MediaPlayerArena*)p_arena)->huge_pages = TRUE;
+    gst_allocator_register(MEDIA_PLAYER_ARENA_HUGE_PAGES_NAME, p_arena);
+}
+
+/**
+ * \brief Get the process wide frame arena
+ * \details Arenas live for the life of the process.
+ *
+ * \param[in] huge_pages - TRUE for the huge page backed arena
+ *
+ * \return GstAllocator* - ref to the arena, unref when done
+ * \author Jason Neitzert
+ */
+GstAllocator *media_player_arena_get(gboolean huge_pages)
+{
+    return gst_allocator_find(huge_pages ? MEDIA_PLAYER_ARENA_HUGE_PAGES_NAME : MEDIA_PLAYER_ARENA_NAME);
+}
+
+/**
+ * \brief Propose an arena backed pool in an ALLOCATION query the sink has answered
+ * \details Pools and allocators giving special memory, such as shared with
+ *          the display, are kept as the sink can't render arena memory
+ *          without a copy.
+ *
+ * \param[in] p_query    - allocation query on its way back upstream
+ * \param[in] huge_pages - TRUE to use the huge page backed arena
+ *
+ * \return gboolean - TRUE if the arena was proposed
+ * \author Jason Neitzert
+ */
+gboolean media_player_arena_propose_allocation(GstQuery *p_query, gboolean huge_pages)
+{
+    GstCaps             *p_caps      = NULL;
+    GstBufferPool       *p_pool      = NULL;
+    GstAllocator        *p_allocator = NULL;
+    GstAllocator        *p_arena     = NULL;
+    GstStructure        *p_config    = NULL;
+    GstAllocationParams  params;
+    GstVideoInfo         info;
+    gboolean             need_pool   = FALSE;
+    gboolean             proposed    = FALSE;
+    guint                size        = 0;
+    guint                min         = 0;
+    guint                max         = 0;
+
+    gst_allocation_params_init(&params);
+    gst_query_parse_allocation(p_query, &p_caps, &need_pool);
+
+    if (gst_query_get_n_allocation_pools(p_query))
+    {
+        gst_query_parse_nth_allocation_pool(p_query, 0, &p_pool, &size, &min, &max);
+    }
+
+    if (gst_query_get_n_allocation_params(p_query))
+    {
+        gst_query_parse_nth_allocation_param(p_query, 0, &p_allocator, &params);
+    }
+
+    if (p_caps && gst_video_info_from_caps(&info, p_caps) && media_player_arena_is_system_memory(p_pool, p_allocator))
+    {
+        p_arena = media_player_arena_get(huge_pages);
+        size    = MAX(size, (guint)GST_VIDEO_INFO_SIZE(&info));
+
+        if (p_pool)
+        {
+            gst_object_unref(p_pool);
+        }
+
+        /* Decoders reconfigure the pool themselves, this is only the starting point */
+        p_pool   = gst_video_buffer_pool_new();
+        p_config = gst_buffer_pool_get_config(p_pool);
+        gst_buffer_pool_config_set_params(p_config, p_caps, size, min, max);
+        gst_buffer_pool_config_set_allocator(p_config, p_arena, &params);
+        (void)gst_buffer_pool_set_config(p_pool, p_config);
+
+        if (gst_query_get_n_allocation_pools(p_query))
+        {
+            gst_query_set_nth_allocation_pool(p_query, 0, p_pool, size, min, max);
+        }
+        else
+        {
+            gst_query_add_allocation_pool(p_query, p_pool, size, min, max);
+        }
+
+        if (gst_query_get_n_allocation_params(p_query))
+        {
+            gst_query_set_nth_allocation_param(p_query, 0, p_arena, &params);
+        }
+        else
+        {
+            gst_query_add_allocation_param(p_query, p_arena, &params);
+        }
+
+        gst_object_unref(p_arena);
+        proposed = TRUE;
+    }
+
+    if (p_pool)
+    {
+        gst_object_unref(p_pool);
+    }
+
+    if (p_allocator)
+    {
+        gst_object_unref(p_allocator);
+    }
+
+    return proposed;
+}
@@ -8,6 +8,13 @@
 
 /***************** Includes ********************/
 #include <gst/gst.h>
+#include <gst/video/video.h>
+#include <gst/video/gstvideodecoder.h>
+#include "media_player_snapshot.h"
+#include "media_player_analytics.h"
+#include "media_player_shm_export.h"
+#include "media_player_throttle.h"
+#include "media_player_arena.h"
 
 /***************** Defines *********************/
 #define PACKAGE                     "MediaPlayerPlugin"
@@ -18,6 +25,14 @@
 
 #define GST_TYPE_MEDIA_PLAYER gst_mediaplayer_get_type()
 
+/* Name of element message posted for analytics events */
+#define MEDIA_PLAYER_ANALYTICS_MESSAGE "MediaPlayerAnalytics"
+
+/* Name of element message posted to self so the message thread applies a new throttle */
+#define MEDIA_PLAYER_THROTTLE_MESSAGE  "ApplyThrottle"
+
+#define MEDIA_PLAYER_DEFAULT_URI "https://www.freedesktop.org/software/gstreamer-sdk/data/media/sintel_trailer-480p.webm"
+
 /******************** Enums   ****************************/
 enum
 {
@@ -25,15 +40,78 @@ enum
   LAST_SIGNAL
 };
 
+enum
+{
+  PROP_0,
+  PROP_SNAPSHOT,
+  PROP_ANALYTICS,
+  PROP_SHM_SOCKET_PATH,
+  PROP_SHM_SLOTS,
+  PROP_URI,
+  PROP_THROTTLE,
+  PROP_DECODE_THREADS,
+  PROP_DECODE_LOAD,
+  PROP_FRAME_ARENA,
+  PROP_SHM_PUBLISHED,
+  PROP_SHM_COPIED,
+  PROP_SHM_DROPPED
+};
+
 /***************** Structures ****************************/
+typedef struct GstMediaPlayer GstMediaPlayer;
+
+/* State kept by each sink pad probe, so position can be converted to stream time */
 typedef struct
+{
+    GstMediaPlayer *p_mediaplayer;
+    GstSegment      segment;
+} GstMediaPlayerSinkProbe;
+
+struct GstMediaPlayer
 {
     GstElement element;
 
     GstElement *p_pipeline;    
     gboolean    shutdown;
     GstBus     *p_bus;
-} GstMediaPlayer;
+
+    /* Position/duration/state published for lock free reads by the api */
+    MediaPlayerSnapshot     snapshot;
+    GstMediaPlayerSinkProbe video_sink_probe;
+    GstMediaPlayerSinkProbe audio_sink_probe;
+
+    /* Set while the video sink is streaming, position then only comes from video */
+    gint                    video_positions;
+
+    /* Frame analytics. State is only touched from the video streaming thread */
+    gint                 analytics_enabled;
+    MediaPlayerAnalytics analytics;
+    GstVideoInfo         analytics_info;
+    gboolean             analytics_info_valid;
+
+    /* Shared memory frame export, active between READY and NULL when a socket path is set */
+    gchar                *p_shm_socket_path;
+    guint                 shm_slots;
+    MediaPlayerShmExport *p_shm_export;
+
+    gchar *p_uri;
+
+    /* Throttling requested by the governor. Only the message thread applies it to the pipeline */
+    gint     throttle;
+
+    /* Video sink made for the pipeline, late frames are only counted from it */
+    GstElement *p_video_sink;
+
+    /* Threads decoders are limited to (0 leaves decoder default), and estimated load in millicores */
+    guint    decode_threads;
+    gint     decode_load;
+
+    /* GWeakRefs to the video decoders playbin made, so decode-threads reaches them. Under object lock */
+    GSList  *p_decoders;
+
+    /* MediaPlayerArenaMode, checked on each allocation query */
+    gint     frame_arena;
+};
 
 typedef struct 
 {
@@ -45,6 +123,14 @@ typedef struct
 static gboolean mediaplayer_plugin_init(GstPlugin *p_plugin);
 static GstStateChangeReturn gst_mediaplayer_change_state(GstElement *p_element,
                                                          GstStateChange transition);
+static void gst_mediaplayer_get_property(GObject *p_object, guint prop_id,
+                                         GValue *p_value, GParamSpec *p_pspec);
+static void gst_mediaplayer_set_property(GObject *p_object, guint prop_id,
+                                         const GValue *p_value, GParamSpec *p_pspec);
+static void gst_mediaplayer_finalize(GObject *p_object);
+static void gst_mediaplayer_apply_decode_threads(GstMediaPlayer *p_mediaplayer);
+static void gst_mediaplayer_clear_decoders(GstMediaPlayer *p_mediaplayer);
+static void gst_mediaplayer_post_throttle(GstMediaPlayer *p_mediaplayer);
 
 
 /***************** Public Global Variables ***************/
@@ -80,6 +166,8 @@ static gboolean mediaplayer_plugin_init(GstPlugin *p_plugin)
 {
     GST_DEBUG_CATEGORY_INIT(media_player_plugin_debug, "mediaplayer", 0, "Media Player Plugin Debug");
 
+    media_player_arena_register();
+
     return gst_element_register(p_plugin, "mediaplayer", GST_RANK_PRIMARY, GST_TYPE_MEDIA_PLAYER);
 }
 
@@ -102,6 +190,94 @@ static void gst_mediaplayer_class_init(GstMediaPlayerClass *p_klass)
     gst_mediaplayer_signals[SIGNAL_MESSAGE_CALLBACK] = g_signal_new("message-callback",
                                                                      GST_TYPE_MEDIA_PLAYER, G_SIGNAL_NO_HOOKS,
                                                                      0, NULL, NULL, NULL, G_TYPE_NONE, 1, GST_TYPE_MESSAGE);
+
+    p_object_class->get_property = gst_mediaplayer_get_property;
+    p_object_class->set_property = gst_mediaplayer_set_property;
+    p_object_class->finalize     = gst_mediaplayer_finalize;
+
+    /* Pointer to the MediaPlayerSnapshot of this instance. It is valid for the lifetime of
+       the element, so callers can fetch it once and poll it without going through GObject */
+    g_object_class_install_property(p_object_class, PROP_SNAPSHOT,
+                                    g_param_spec_pointer("snapshot", "Snapshot",
+                                                         "Pointer to MediaPlayerSnapshot of this player",
+                                                         G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+    /* When enabled each video frame is analysed and MEDIA_PLAYER_ANALYTICS_MESSAGE element
+       messages are sent through message-callback for scene change/black/frozen frames */
+    g_object_class_install_property(p_object_class, PROP_ANALYTICS,
+                                    g_param_spec_boolean("analytics", "Analytics",
+                                                         "Analyse video frames for scene change/black/frozen frames",
+                                                         FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    /* Decoded frames are published to a memfd ring that local processes attach to through
+       this socket with the media_player_shm library. Only read when going to READY. */
+    g_object_class_install_property(p_object_class, PROP_SHM_SOCKET_PATH,
+                                    g_param_spec_string("shm-socket-path", "Shared Memory Socket Path",
+                                                        "Unix socket to export decoded frames on, NULL to disable",
+                                                        NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(p_object_class, PROP_SHM_SLOTS,
+                                    g_param_spec_uint("shm-slots", "Shared Memory Slots",
+                                                      "Number of frames in the shared memory ring",
+                                                      MEDIA_PLAYER_SHM_MIN_SLOTS, MP_SHM_MAX_SLOTS,
+                                                      MEDIA_PLAYER_SHM_DEFAULT_SLOTS,
+                                                      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    /* Counters of the current shared memory export, 0 while not exporting. Frames are
+       copied into the ring only when upstream didn't decode into the ring's pool */
+    g_object_class_install_property(p_object_class, PROP_SHM_PUBLISHED,
+                                    g_param_spec_uint64("shm-published", "Shared Memory Published",
+                                                        "Frames published to the shared memory ring",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(p_object_class, PROP_SHM_COPIED,
+                                    g_param_spec_uint64("shm-copied", "Shared Memory Copied",
+                                                        "Published frames that had to be copied into the ring",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+    g_object_class_install_property(p_object_class, PROP_SHM_DROPPED,
+                                    g_param_spec_uint64("shm-dropped", "Shared Memory Dropped",
+                                                        "Frames not published because every slot was held",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+    /* Only read when going to READY */
+    g_object_class_install_property(p_object_class, PROP_URI,
+                                    g_param_spec_string("uri", "URI", "URI of the media to play",
+                                                        MEDIA_PLAYER_DEFAULT_URI,
+                                                        G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    /* MediaPlayerThrottle level. Applied asynchronously by the message thread */
+    g_object_class_install_property(p_object_class, PROP_THROTTLE,
+                                    g_param_spec_uint("throttle", "Throttle",
+                                                      "MediaPlayerThrottle level to run the pipeline at",
+                                                      MEDIA_PLAYER_THROTTLE_NONE, MEDIA_PLAYER_THROTTLE_PAUSED,
+                                                      MEDIA_PLAYER_THROTTLE_NONE,
+                                                      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    /* Applied to decoders as playbin creates them, and to existing decoders when it changes */
+    g_object_class_install_property(p_object_class, PROP_DECODE_THREADS,
+                                    g_param_spec_uint("decode-threads", "Decode Threads",
+                                                      "Max threads per video decoder, 0 for decoder default",
+                                                      0, G_MAXINT, 0,
+                                                      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+    /* Notified from the streaming thread when the video format changes */
+    g_object_class_install_property(p_object_class, PROP_DECODE_LOAD,
+                                    g_param_spec_double("decode-load", "Decode Load",
+                                                        "Estimated cores needed to decode the video in real time",
+                                                        0.0, G_MAXDOUBLE, MEDIA_PLAYER_DEFAULT_DECODE_LOAD,
+                                                        G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+    /* Takes effect next time decoders negotiate allocation */
+    g_object_class_install_property(p_object_class, PROP_FRAME_ARENA,
+                                    g_param_spec_uint("frame-arena", "Frame Arena",
+                                                      "MediaPlayerArenaMode to allocate decoded frames with",
+                                                      MEDIA_PLAYER_ARENA_OFF, MEDIA_PLAYER_ARENA_HUGE_PAGES,
+                                                      MEDIA_PLAYER_ARENA_OFF,
+                                                      G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
     
     gst_element_class_set_static_metadata(p_element_class, 
                                          "Awesome Media Player",
@@ -123,12 +299,912 @@ static void gst_mediaplayer_class_init(GstMediaPlayerClass *p_klass)
  */
 static void gst_mediaplayer_init(GstMediaPlayer *p_mediaplayer)
 {   
+    media_player_snapshot_init(&p_mediaplayer->snapshot);
+
+    p_mediaplayer->video_sink_probe.p_mediaplayer = p_mediaplayer;
+    p_mediaplayer->audio_sink_probe.p_mediaplayer = p_mediaplayer;
+    gst_segment_init(&p_mediaplayer->video_sink_probe.segment, GST_FORMAT_UNDEFINED);
+    gst_segment_init(&p_mediaplayer->audio_sink_probe.segment, GST_FORMAT_UNDEFINED);
+
+    media_player_analytics_init(&p_mediaplayer->analytics);
+
+    p_mediaplayer->shm_slots = MEDIA_PLAYER_SHM_DEFAULT_SLOTS;
+
+    p_mediaplayer->p_uri       = g_strdup(MEDIA_PLAYER_DEFAULT_URI);
+    p_mediaplayer->decode_load = (gint)(MEDIA_PLAYER_DEFAULT_DECODE_LOAD * 1000);
+}
+
+/**
+ * \brief Finalize for mediaplayer class
+ * 
+ * \param[in] p_object - pointer to instance
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void gst_mediaplayer_finalize(GObject *p_object)
+{
+    GstMediaPlayer *p_mediaplayer = (GstMediaPlayer*)p_object;
+
+    gst_mediaplayer_clear_decoders(p_mediaplayer);
+    media_player_snapshot_clear(&p_mediaplayer->snapshot);
+    media_player_analytics_clear(&p_mediaplayer->analytics);
+    g_free(p_mediaplayer->p_shm_socket_path);
+    g_free(p_mediaplayer->p_uri);
+
+    G_OBJECT_CLASS(gst_mediaplayer_parent_class)->finalize(p_object);
+}
+
+/**
+ * \brief Get Property for mediaplayer class
+ * 
+ * \param[in]  p_object - pointer to instance
+ * \param[in]  prop_id  - id of property to get
+ * \param[out] p_value  - value of the property
+ * \param[in]  p_pspec  - param spec of the property
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void gst_mediaplayer_get_property(GObject *p_object, guint prop_id,
+                                         GValue *p_value, GParamSpec *p_pspec)
+{
+    GstMediaPlayer *p_mediaplayer = (GstMediaPlayer*)p_object;
+
+    switch (prop_id)
+    {
+        case PROP_SNAPSHOT:
+        {
+            g_value_set_pointer(p_value, &p_mediaplayer->snapshot);
+            break;
+        }
+        case PROP_ANALYTICS:
+        {
+            g_value_set_boolean(p_value, g_atomic_int_get(&p_mediaplayer->analytics_enabled));
+            break;
+        }
+        case PROP_SHM_SOCKET_PATH:
+        {
+            g_value_set_string(p_value, p_mediaplayer->p_shm_socket_path);
+            break;
+        }
+        case PROP_SHM_SLOTS:
+        {
+            g_value_set_uint(p_value, p_mediaplayer->shm_slots);
+            break;
+        }
+        case PROP_URI:
+        {
+            g_value_set_string(p_value, p_mediaplayer->p_uri);
+            break;
+        }
+        case PROP_THROTTLE:
+        {
+            g_value_set_uint(p_value, g_atomic_int_get(&p_mediaplayer->throttle));
+            break;
+        }
+        case PROP_DECODE_THREADS:
+        {
+            g_value_set_uint(p_value, g_atomic_int_get(&p_mediaplayer->decode_threads));
+            break;
+        }
+        case PROP_DECODE_LOAD:
+        {
+            g_value_set_double(p_value, g_atomic_int_get(&p_mediaplayer->decode_load) / 1000.0);
+            break;
+        }
+        case PROP_FRAME_ARENA:
+        {
+            g_value_set_uint(p_value, g_atomic_int_get(&p_mediaplayer->frame_arena));
+            break;
+        }
+        case PROP_SHM_PUBLISHED:
+        case PROP_SHM_COPIED:
+        case PROP_SHM_DROPPED:
+        {
+            /* Object lock keeps the export from being freed while reading it */
+            GST_OBJECT_LOCK(p_mediaplayer);
+            if (!p_mediaplayer->p_shm_export)
+            {
+                g_value_set_uint64(p_value, 0);
+            }
+            else if (PROP_SHM_PUBLISHED == prop_id)
+            {
+                g_value_set_uint64(p_value, media_player_shm_export_get_published(p_mediaplayer->p_shm_export));
+            }
+            else if (PROP_SHM_COPIED == prop_id)
+            {
+                g_value_set_uint64(p_value, media_player_shm_export_get_copied(p_mediaplayer->p_shm_export));
+            }
+            else
+            {
+                g_value_set_uint64(p_value, media_player_shm_export_get_dropped(p_mediaplayer->p_shm_export));
+            }
+            GST_OBJECT_UNLOCK(p_mediaplayer);
+            break;
+        }
+        default:
+        {
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(p_object, prop_id, p_pspec);
+            break;
+        }
+    }
+}
+
+/**
+ * \brief Set Property for mediaplayer class
+ * 
+ * \param[in] p_object - pointer to instance
+ * \param[in] prop_id  - id of property to set
+ * \param[in] p_value  - new value of the property
+ * \param[in] p_pspec  - param spec of the property
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void gst_mediaplayer_set_property(GObject *p_object, guint prop_id,
+                                         const GValue *p_value, GParamSpec *p_pspec)
+{
+    GstMediaPlayer *p_mediaplayer = (GstMediaPlayer*)p_object;
+
+    switch (prop_id)
+    {
+        case PROP_ANALYTICS:
+        {
+            g_atomic_int_set(&p_mediaplayer->analytics_enabled, g_value_get_boolean(p_value));
+            break;
+        }
+        case PROP_SHM_SOCKET_PATH:
+        {
+            g_free(p_mediaplayer->p_shm_socket_path);
+            p_mediaplayer->p_shm_socket_path = g_value_dup_string(p_value);
+            break;
+        }
+        case PROP_SHM_SLOTS:
+        {
+            p_mediaplayer->shm_slots = g_value_get_uint(p_value);
+            break;
+        }
+        case PROP_URI:
+        {
+            g_free(p_mediaplayer->p_uri);
+            p_mediaplayer->p_uri = g_value_dup_string(p_value);
+            break;
+        }
+        case PROP_THROTTLE:
+        {
+            /* Seeks and state changes can't be done from whatever thread set us, so
+               hand over to the message thread. Dropped if not running, it applies
+               the throttle itself once the pipeline prerolls. */
+            g_atomic_int_set(&p_mediaplayer->throttle, g_value_get_uint(p_value));
+            gst_mediaplayer_post_throttle(p_mediaplayer);
+            break;
+        }
+        case PROP_DECODE_THREADS:
+        {
+            if (g_value_get_uint(p_value) != (guint)g_atomic_int_get(&p_mediaplayer->decode_threads))
+            {
+                g_atomic_int_set(&p_mediaplayer->decode_threads, g_value_get_uint(p_value));
+                gst_mediaplayer_apply_decode_threads(p_mediaplayer);
+            }
+            break;
+        }
+        case PROP_FRAME_ARENA:
+        {
+            g_atomic_int_set(&p_mediaplayer->frame_arena, g_value_get_uint(p_value));
+            break;
+        }
+        default:
+        {
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(p_object, prop_id, p_pspec);
+            break;
+        }
+    }
+}
+
+/**
+ * \brief Estimate decode load from new video caps, for the governor
+ * 
+ * \param[in] p_mediaplayer - pointer to instance structure
+ * \param[in] p_event       - caps event reaching the video sink
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void gst_mediaplayer_update_decode_load(GstMediaPlayer *p_mediaplayer, GstEvent *p_event)
+{
+    GstCaps      *p_caps = NULL;
+    GstVideoInfo  info;
+    gdouble       fps    = 0.0;
+    gint          load   = 0;
+
+    gst_event_parse_caps(p_event, &p_caps);
+
+    if (gst_video_info_from_caps(&info, p_caps))
+    {
+        /* Unknown or variable framerate is treated as 30fps */
+        fps  = (GST_VIDEO_INFO_FPS_N(&info) && GST_VIDEO_INFO_FPS_D(&info)) ? 
+                   ((gdouble)GST_VIDEO_INFO_FPS_N(&info) / GST_VIDEO_INFO_FPS_D(&info)) : 30.0;
+        load = (gint)((GST_VIDEO_INFO_WIDTH(&info) * (gdouble)GST_VIDEO_INFO_HEIGHT(&info) * fps * 1000.0) / 
+                      MEDIA_PLAYER_REFERENCE_LOAD_PIXEL_RATE);
+        load = MAX(load, 1);
+
+        if (load != g_atomic_int_get(&p_mediaplayer->decode_load))
+        {
+            g_atomic_int_set(&p_mediaplayer->decode_load, load);
+            g_object_notify((GObject*)p_mediaplayer, "decode-load");
+        }
+    }
+}
+
+/**
+ * \brief Find the property a video decoder limits its threads with
+ * 
+ * \param[in] p_element - element to look at
+ * 
+ * \return GParamSpec* - the threads property, NULL if not a decoder or it has none
+ * \author Jason Neitzert
+ */
+static GParamSpec *gst_mediaplayer_decoder_threads_property(GstElement *p_element)
+{
+    GObjectClass *p_class = G_OBJECT_GET_CLASS(p_element);
+    GParamSpec   *p_pspec = NULL;
+
+    if (GST_IS_VIDEO_DECODER(p_element))
+    {
+        /* No common property for this, libav uses max-threads and libvpx threads */
+        if (!(p_pspec = g_object_class_find_property(p_class, "max-threads")))
+        {
+            p_pspec = g_object_class_find_property(p_class, "threads");
+        }
+    }
+
+    return p_pspec;
+}
+
+/**
+ * \brief Limit a decoder to threads, or put it back to its default for 0
+ * \details Decoders read the limit when they configure a stream, so a
+ *          running decoder picks it up on its next caps change or seek.
+ * 
+ * \param[in] p_element - decoder
+ * \param[in] p_pspec   - its threads property
+ * \param[in] threads   - thread limit, 0 for decoder default
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void gst_mediaplayer_set_decoder_threads(GstElement *p_element, GParamSpec *p_pspec, guint threads)
+{
+    GValue value = G_VALUE_INIT;
+
+    g_value_init(&value, G_PARAM_SPEC_VALUE_TYPE(p_pspec));
+
+    if (0 == threads)
+    {
+        g_param_value_set_default(p_pspec, &value);
+    }
+    else if (G_TYPE_INT == G_PARAM_SPEC_VALUE_TYPE(p_pspec))
+    {
+        g_value_set_int(&value, (gint)threads);
+    }
+    else
+    {
+        g_value_set_uint(&value, threads);
+    }
+
+    g_object_set_property((GObject*)p_element, p_pspec->name, &value);
+    g_value_unset(&value);
+}
+
+/**
+ * \brief Apply decode-threads to the decoders of the running pipeline
+ * 
+ * \param[in] p_mediaplayer - pointer to instance structure
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void gst_mediaplayer_apply_decode_threads(GstMediaPlayer *p_mediaplayer)
+{
+    GSList     *p_decoders = NULL;
+    GSList     *p_item     = NULL;
+    GstElement *p_decoder  = NULL;
+
+    /* Properties are set outside the lock, decoders may notify from them */
+    GST_OBJECT_LOCK(p_mediaplayer);
+    for (p_item = p_mediaplayer->p_decoders; p_item; p_item = p_item->next)
+    {
+        if ((p_decoder = g_weak_ref_get((GWeakRef*)p_item->data)))
+        {
+            p_decoders = g_slist_prepend(p_decoders, p_decoder);
+        }
+    }
+    GST_OBJECT_UNLOCK(p_mediaplayer);
+
+    for (p_item = p_decoders; p_item; p_item = p_item->next)
+    {
+        gst_mediaplayer_set_decoder_threads((GstElement*)p_item->data,
+                                            gst_mediaplayer_decoder_threads_property((GstElement*)p_item->data),
+                                            g_atomic_int_get(&p_mediaplayer->decode_threads));
+    }
+
+    g_slist_free_full(p_decoders, gst_object_unref);
+}
+
+/**
+ * \brief Free a decoder weak reference
+ * 
+ * \param[in] p_data - GWeakRef to free
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void gst_mediaplayer_free_decoder_ref(gpointer p_data)
+{
+    g_weak_ref_clear((GWeakRef*)p_data);
+    g_free(p_data);
+}
+
+/**
+ * \brief Forget the decoders of a pipeline that is going away
+ * 
+ * \param[in] p_mediaplayer - pointer to instance structure
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void gst_mediaplayer_clear_decoders(GstMediaPlayer *p_mediaplayer)
+{
+    GSList *p_decoders = NULL;
+
+    GST_OBJECT_LOCK(p_mediaplayer);
+    p_decoders                = p_mediaplayer->p_decoders;
+    p_mediaplayer->p_decoders = NULL;
+    GST_OBJECT_UNLOCK(p_mediaplayer);
+
+    g_slist_free_full(p_decoders, gst_mediaplayer_free_decoder_ref);
+}
+
+/**
+ * \brief Limit decoder threads as playbin creates decoders
+ * \details Decoders are remembered so later decode-threads changes from the
+ *          governor reach them too.
+ * 
+ * \param[in] p_playbin     - playbin the element was added to
+ * \param[in] p_element     - element that was added
+ * \param[in] p_mediaplayer - pointer to instance structure
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void gst_mediaplayer_element_setup(GstElement *p_playbin, GstElement *p_element, GstMediaPlayer *p_mediaplayer)
+{
+    guint       threads = g_atomic_int_get(&p_mediaplayer->decode_threads);
+    GParamSpec *p_pspec = gst_mediaplayer_decoder_threads_property(p_element);
+    GWeakRef   *p_ref   = NULL;
+    GSList     *p_item  = NULL;
+    GSList     *p_next  = NULL;
+    GstElement *p_other = NULL;
+
+    if (p_pspec)
+    {
+        if (threads)
+        {
+            gst_mediaplayer_set_decoder_threads(p_element, p_pspec, threads);
+        }
+
+        p_ref = g_new0(GWeakRef, 1);
+        g_weak_ref_init(p_ref, p_element);
+
+        /* Drop decoders playbin has already thrown away while here, so switching
+           streams doesn't grow the list */
+        GST_OBJECT_LOCK(p_mediaplayer);
+        for (p_item = p_mediaplayer->p_decoders; p_item; p_item = p_next)
+        {
+            p_next = p_item->next;
+
+            if ((p_other = g_weak_ref_get((GWeakRef*)p_item->data)))
+            {
+                gst_object_unref(p_other);
+            }
+            else
+            {
+                gst_mediaplayer_free_decoder_ref(p_item->data);
+                p_mediaplayer->p_decoders = g_slist_delete_link(p_mediaplayer->p_decoders, p_item);
+            }
+        }
+        p_mediaplayer->p_decoders = g_slist_prepend(p_mediaplayer->p_decoders, p_ref);
+        GST_OBJECT_UNLOCK(p_mediaplayer);
+    }
+}
+
+/**
+ * \brief Ask the message thread to bring the pipeline in line with the throttle
+ * \details Dropped if the message thread isn't running, it applies the
+ *          throttle itself once the pipeline prerolls.
+ * 
+ * \param[in] p_mediaplayer - pointer to instance structure
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void gst_mediaplayer_post_throttle(GstMediaPlayer *p_mediaplayer)
+{
+    gst_element_post_message((GstElement*)p_mediaplayer,
+                             gst_message_new_element((GstObject*)p_mediaplayer,
+                                                     gst_structure_new_empty(MEDIA_PLAYER_THROTTLE_MESSAGE)));
+}
+
+/**
+ * \brief Apply the requested throttle to the pipeline
+ * \details Only called from the message thread, which is the only place the
+ *          pipeline is moved between PAUSED and PLAYING for throttling. The
+ *          pipeline state is worked out from our own target state and the
+ *          requested throttle every time, so there is no applied state to
+ *          race with change_state. Key frame only decoding is a flushing
+ *          trick mode seek, so it waits until the pipeline has prerolled.
+ * 
+ * \param[in]     p_mediaplayer - pointer to instance structure
+ * \param[in]     p_pipeline    - pipeline to throttle
+ * \param[in,out] p_key_units   - whether the pipeline is decoding key frames only, owned by the message thread
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void gst_mediaplayer_apply_throttle(GstMediaPlayer *p_mediaplayer, GstElement *p_pipeline, gboolean *p_key_units)
+{
+    MediaPlayerThrottle throttle        = g_atomic_int_get(&p_mediaplayer->throttle);
+    gboolean            key_units       = (MEDIA_PLAYER_THROTTLE_KEY_UNITS == throttle);
+    GstSeekFlags        seek_flags      = GST_SEEK_FLAG_FLUSH;
+    GstState            target          = GST_STATE_VOID_PENDING;
+    GstState            pipeline_target = GST_STATE_VOID_PENDING;
+    GstState            desired         = GST_STATE_PAUSED;
+    gint64              position        = 0;
+
+    GST_OBJECT_LOCK(p_mediaplayer);
+    target = GST_STATE_TARGET(p_mediaplayer);
+    GST_OBJECT_UNLOCK(p_mediaplayer);
+
+    GST_OBJECT_LOCK(p_pipeline);
+    pipeline_target = GST_STATE_TARGET(p_pipeline);
+    GST_OBJECT_UNLOCK(p_pipeline);
+
+    /* Below PAUSED throttling has nothing to do, change_state owns the pipeline state */
+    if (target >= GST_STATE_PAUSED)
+    {
+        if ((GST_STATE_PLAYING == target) && (MEDIA_PLAYER_THROTTLE_PAUSED != throttle))
+        {
+            desired = GST_STATE_PLAYING;
+        }
+
+        if (desired != pipeline_target)
+        {
+            (void)gst_element_set_state(p_pipeline, desired);
+        }
+
+        if ((MEDIA_PLAYER_THROTTLE_PAUSED != throttle) && (key_units != *p_key_units) &&
+            gst_element_query_position(p_pipeline, GST_FORMAT_TIME, &position))
+        {
+            if (key_units)
+            {
+                seek_flags |= GST_SEEK_FLAG_KEY_UNIT | GST_SEEK_FLAG_TRICKMODE | GST_SEEK_FLAG_TRICKMODE_KEY_UNITS;
+            }
+            else
+            {
+                /* Resume exactly where key frame decoding got to, not at the previous key frame */
+                seek_flags |= GST_SEEK_FLAG_ACCURATE;
+            }
+
+            if (gst_element_seek(p_pipeline, 1.0, GST_FORMAT_TIME, seek_flags, 
+                                 GST_SEEK_TYPE_SET, position, GST_SEEK_TYPE_NONE, GST_CLOCK_TIME_NONE))
+            {
+                *p_key_units = key_units;
+            }
+        }
+    }
+}
+
+/**
+ * \brief Pad probe on the sinks which keeps the snapshot position current
+ * \details Runs in the streaming thread. Only looks at data already flowing
+ *          through the pad, so it never queries or locks the pipeline.
+ *          Position is written from one sink, video while it is streaming
+ *          and audio otherwise, so it doesn't jump between the two streams.
+ * 
+ * \param[in] p_pad  - sink pad probe is installed on
+ * \param[in] p_info - probe info with the buffer or event
+ * \param[in] p_data - GstMediaPlayerSinkProbe for this sink
+ * 
+ * \return GstPadProbeReturn - always GST_PAD_PROBE_OK so data passes through
+ * \author Jason Neitzert
+ */
+static GstPadProbeReturn gst_mediaplayer_sink_probe(GstPad *p_pad, GstPadProbeInfo *p_info, gpointer p_data)
+{
+    GstMediaPlayerSinkProbe *p_probe  = (GstMediaPlayerSinkProbe*)p_data;
+    GstBuffer               *p_buffer = NULL;
+    GstEvent                *p_event  = NULL;
+    GstClockTime             position = GST_CLOCK_TIME_NONE;
+    gboolean                 is_video = (p_probe == &p_probe->p_mediaplayer->video_sink_probe);
+
+    if (p_info->type & GST_PAD_PROBE_TYPE_BUFFER)
+    {
+        p_buffer = GST_PAD_PROBE_INFO_BUFFER(p_info);
+
+        if ((GST_FORMAT_TIME == p_probe->segment.format) && GST_BUFFER_PTS_IS_VALID(p_buffer) &&
+            (is_video || !g_atomic_int_get(&p_probe->p_mediaplayer->video_positions)))
+        {
+            position = gst_segment_to_stream_time(&p_probe->segment, GST_FORMAT_TIME, GST_BUFFER_PTS(p_buffer));
+
+            if (GST_CLOCK_TIME_IS_VALID(position))
+            {
+                media_player_snapshot_set_position(&p_probe->p_mediaplayer->snapshot, position);
+            }
+        }
+    }
+    else if (p_info->type & (GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM | GST_PAD_PROBE_TYPE_EVENT_FLUSH))
+    {
+        p_event = GST_PAD_PROBE_INFO_EVENT(p_info);
+
+        if (GST_EVENT_SEGMENT == GST_EVENT_TYPE(p_event))
+        {
+            gst_event_copy_segment(p_event, &p_probe->segment);
+        }
+        else if ((GST_EVENT_CAPS == GST_EVENT_TYPE(p_event)) && is_video)
+        {
+            g_atomic_int_set(&p_probe->p_mediaplayer->video_positions, TRUE);
+            gst_mediaplayer_update_decode_load(p_probe->p_mediaplayer, p_event);
+        }
+        else if ((GST_EVENT_EOS == GST_EVENT_TYPE(p_event)) && is_video)
+        {
+            /* Audio may outlast the video, let it carry position on */
+            g_atomic_int_set(&p_probe->p_mediaplayer->video_positions, FALSE);
+        }
+        else if (GST_EVENT_FLUSH_STOP == GST_EVENT_TYPE(p_event))
+        {
+            gst_segment_init(&p_probe->segment, GST_FORMAT_UNDEFINED);
+        }
+    }
+
+    return GST_PAD_PROBE_OK;
+}
+
+/**
+ * \brief Post an analytics message for each event raised by a frame
+ * 
+ * \param[in] p_mediaplayer - pointer to instance structure
+ * \param[in] events        - events raised for the frame
+ * \param[in] timestamp     - stream time of the frame
+ * \param[in] p_stats       - stats computed for the frame
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void gst_mediaplayer_post_analytics(GstMediaPlayer *p_mediaplayer, MediaPlayerAnalyticsEvent events,
+                                           GstClockTime timestamp, const MediaPlayerFrameStats *p_stats)
+{
+    guint event = 0;
+
+    for (event = eMPA_EVENT_SCENE_CHANGE; event <= eMPA_EVENT_FROZEN_FRAME; event <<= 1)
+    {
+        if (events & event)
+        {
+            gst_element_post_message((GstElement*)p_mediaplayer,
+                                     gst_message_new_element((GstObject*)p_mediaplayer,
+                                                             gst_structure_new(MEDIA_PLAYER_ANALYTICS_MESSAGE,
+                                                                               "event",      G_TYPE_UINT,   event,
+                                                                               "timestamp",  G_TYPE_UINT64, timestamp,
+                                                                               "mean",       G_TYPE_DOUBLE, p_stats->mean,
+                                                                               "variance",   G_TYPE_DOUBLE, p_stats->variance,
+                                                                               "difference", G_TYPE_DOUBLE, p_stats->difference,
+                                                                               NULL)));
+        }
+    }
+}
+
+/**
+ * \brief Pad probe on the video sink which runs frame analytics
+ * \details Runs in the video streaming thread, analysing the luma plane in
+ *          place. Formats without an 8 bit luma plane are passed through untouched.
+ * 
+ * \param[in] p_pad  - sink pad probe is installed on
+ * \param[in] p_info - probe info with the buffer or event
+ * \param[in] p_data - pointer to mediaplayer instance
+ * 
+ * \return GstPadProbeReturn - always GST_PAD_PROBE_OK so data passes through
+ * \author Jason Neitzert
+ */
+static GstPadProbeReturn gst_mediaplayer_analytics_probe(GstPad *p_pad, GstPadProbeInfo *p_info, gpointer p_data)
+{
+    GstMediaPlayer           *p_mediaplayer = (GstMediaPlayer*)p_data;
+    GstVideoInfo             *p_video_info  = &p_mediaplayer->analytics_info;
+    GstEvent                 *p_event       = NULL;
+    GstCaps                  *p_caps        = NULL;
+    GstBuffer                *p_buffer      = NULL;
+    GstSegment               *p_segment     = &p_mediaplayer->video_sink_probe.segment;
+    GstClockTime              timestamp     = GST_CLOCK_TIME_NONE;
+    GstVideoFrame             frame;
+    MediaPlayerFrameStats     stats;
+    MediaPlayerAnalyticsEvent events        = eMPA_EVENT_NONE;
+
+    if (p_info->type & GST_PAD_PROBE_TYPE_BUFFER)
+    {
+        p_buffer = GST_PAD_PROBE_INFO_BUFFER(p_info);
+
+        if (g_atomic_int_get(&p_mediaplayer->analytics_enabled) && p_mediaplayer->analytics_info_valid &&
+            gst_video_frame_map(&frame, p_video_info, p_buffer, GST_MAP_READ))
+        {
+            events = media_player_analytics_process(&p_mediaplayer->analytics,
+                                                    GST_VIDEO_FRAME_COMP_DATA(&frame, 0),
+                                                    GST_VIDEO_FRAME_COMP_STRIDE(&frame, 0),
+                                                    GST_VIDEO_FRAME_COMP_WIDTH(&frame, 0),
+                                                    GST_VIDEO_FRAME_COMP_HEIGHT(&frame, 0),
+                                                    &stats);
+            gst_video_frame_unmap(&frame);
+
+            if (events)
+            {
+                /* Segment is kept up to date by the snapshot probe, which runs first */
+                if ((GST_FORMAT_TIME == p_segment->format) && GST_BUFFER_PTS_IS_VALID(p_buffer))
+                {
+                    timestamp = gst_segment_to_stream_time(p_segment, GST_FORMAT_TIME, GST_BUFFER_PTS(p_buffer));
+                }
+
+                gst_mediaplayer_post_analytics(p_mediaplayer, events, timestamp, &stats);
+            }
+        }
+    }
+    else if (p_info->type & (GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM | GST_PAD_PROBE_TYPE_EVENT_FLUSH))
+    {
+        p_event = GST_PAD_PROBE_INFO_EVENT(p_info);
+
+        if (GST_EVENT_CAPS == GST_EVENT_TYPE(p_event))
+        {
+            gst_event_parse_caps(p_event, &p_caps);
+
+            /* Need an 8 bit luma plane we can walk byte by byte */
+            p_mediaplayer->analytics_info_valid = gst_video_info_from_caps(p_video_info, p_caps) &&
+                                                  (GST_VIDEO_INFO_IS_YUV(p_video_info) || GST_VIDEO_INFO_IS_GRAY(p_video_info)) &&
+                                                  (8 == GST_VIDEO_INFO_COMP_DEPTH(p_video_info, 0)) &&
+                                                  (1 == GST_VIDEO_INFO_COMP_PSTRIDE(p_video_info, 0));
+            media_player_analytics_reset(&p_mediaplayer->analytics);
+        }
+        else if (GST_EVENT_FLUSH_STOP == GST_EVENT_TYPE(p_event))
+        {
+            media_player_analytics_reset(&p_mediaplayer->analytics);
+        }
+    }
+
+    return GST_PAD_PROBE_OK;
+}
+
+/**
+ * \brief Create a sink for playbin and install the snapshot probe on it
+ * 
+ * \param[in] p_factory_name - name of the sink factory to create
+ * \param[in] p_probe        - probe state to pass to the probe
+ * 
+ * \return GstElement* - the sink, or NULL on failure
+ * \author Jason Neitzert
+ */
+static GstElement *gst_mediaplayer_make_sink(const gchar *p_factory_name, GstMediaPlayerSinkProbe *p_probe)
+{
+    GstElement *p_sink = NULL;
+    GstPad     *p_pad  = NULL;
+
+    if (!(p_sink = gst_element_factory_make(p_factory_name, NULL)))
+    {
+        GST_ERROR("Failed to create %s", p_factory_name);
+    }
+    else if (!(p_pad = gst_element_get_static_pad(p_sink, "sink")))
+    {
+        GST_ERROR("Failed to get sink pad of %s", p_factory_name);
+        gst_object_unref(p_sink);
+        p_sink = NULL;
+    }
+    else
+    {
+        gst_segment_init(&p_probe->segment, GST_FORMAT_UNDEFINED);
+        gst_pad_add_probe(p_pad, GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM | 
+                                 GST_PAD_PROBE_TYPE_EVENT_FLUSH,
+                          gst_mediaplayer_sink_probe, p_probe, NULL);
+        gst_object_unref(p_pad);
+    }
+
+    return p_sink;
+}
+
+/**
+ * \brief Install the analytics probe on the video sink
+ * \details The probe is always installed and checks the analytics property
+ *          per buffer, so analytics can be toggled while playing.
+ * 
+ * \param[in] p_mediaplayer - pointer to instance structure
+ * \param[in] p_video_sink  - video sink made by gst_mediaplayer_make_sink
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void gst_mediaplayer_add_analytics_probe(GstMediaPlayer *p_mediaplayer, GstElement *p_video_sink)
+{
+    GstPad *p_pad = gst_element_get_static_pad(p_video_sink, "sink");
+
+    p_mediaplayer->analytics_info_valid = FALSE;
+    media_player_analytics_reset(&p_mediaplayer->analytics);
+
+    gst_pad_add_probe(p_pad, GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM | 
+                             GST_PAD_PROBE_TYPE_EVENT_FLUSH,
+                      gst_mediaplayer_analytics_probe, p_mediaplayer, NULL);
+    gst_object_unref(p_pad);
+}
+
+/**
+ * \brief Pad probe on the video sink which proposes the frame arena to decoders
+ * \details Runs after the sink has answered the ALLOCATION query, so the
+ *          sink's own answer is seen and kept if it isn't system memory.
+ * 
+ * \param[in] p_pad  - sink pad probe is installed on
+ * \param[in] p_info - probe info with the query
+ * \param[in] p_data - pointer to instance structure
+ * 
+ * \return GstPadProbeReturn - always GST_PAD_PROBE_OK so the query passes through
+ * \author Jason Neitzert
+ */
+static GstPadProbeReturn gst_mediaplayer_arena_probe(GstPad *p_pad, GstPadProbeInfo *p_info, gpointer p_data)
+{
+    GstMediaPlayer       *p_mediaplayer = (GstMediaPlayer*)p_data;
+    GstQuery             *p_query       = GST_PAD_PROBE_INFO_QUERY(p_info);
+    MediaPlayerArenaMode  mode          = g_atomic_int_get(&p_mediaplayer->frame_arena);
+
+    if ((GST_QUERY_ALLOCATION == GST_QUERY_TYPE(p_query)) && (MEDIA_PLAYER_ARENA_OFF != mode))
+    {
+        if (!media_player_arena_propose_allocation(p_query, MEDIA_PLAYER_ARENA_HUGE_PAGES == mode))
+        {
+            GST_DEBUG("Keeping allocation proposed by video sink");
+        }
+    }
+
+    return GST_PAD_PROBE_OK;
+}
+
+/**
+ * \brief Pad probe on the video sink which publishes frames to shared memory
+ * 
+ * \param[in] p_pad  - sink pad probe is installed on
+ * \param[in] p_info - probe info with the buffer or event
+ * \param[in] p_data - pointer to MediaPlayerShmExport
+ * 
+ * \return GstPadProbeReturn - always GST_PAD_PROBE_OK so data passes through
+ * \author Jason Neitzert
+ */
+static GstPadProbeReturn gst_mediaplayer_shm_export_probe(GstPad *p_pad, GstPadProbeInfo *p_info, gpointer p_data)
+{
+    MediaPlayerShmExport *p_export = (MediaPlayerShmExport*)p_data;
+    GstEvent             *p_event  = NULL;
+    GstCaps              *p_caps   = NULL;
+
+    if (p_info->type & GST_PAD_PROBE_TYPE_BUFFER)
+    {
+        (void)media_player_shm_export_publish(p_export, GST_PAD_PROBE_INFO_BUFFER(p_info));
+    }
+    else if (p_info->type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM)
+    {
+        p_event = GST_PAD_PROBE_INFO_EVENT(p_info);
+
+        if (GST_EVENT_CAPS == GST_EVENT_TYPE(p_event))
+        {
+            gst_event_parse_caps(p_event, &p_caps);
+            (void)media_player_shm_export_set_caps(p_export, p_caps);
+        }
+    }
+
+    return GST_PAD_PROBE_OK;
+}
+
+/**
+ * \brief Pad probe on the video sink offering the shared memory ring to decoders
+ * \details Runs on the way back upstream like the arena probe, and is
+ *          installed ahead of it, so the arena leaves the ring's pool alone.
+ * 
+ * \param[in] p_pad  - sink pad probe is installed on
+ * \param[in] p_info - probe info with the query
+ * \param[in] p_data - pointer to MediaPlayerShmExport
+ * 
+ * \return GstPadProbeReturn - always GST_PAD_PROBE_OK so the query passes through
+ * \author Jason Neitzert
+ */
+static GstPadProbeReturn gst_mediaplayer_shm_allocation_probe(GstPad *p_pad, GstPadProbeInfo *p_info, gpointer p_data)
+{
+    GstQuery *p_query = GST_PAD_PROBE_INFO_QUERY(p_info);
+
+    if ((GST_QUERY_ALLOCATION == GST_QUERY_TYPE(p_query)) &&
+        !media_player_shm_export_propose_allocation((MediaPlayerShmExport*)p_data, p_query))
+    {
+        GST_DEBUG("Shared memory ring can't take these frames, they will be copied");
+    }
+
+    return GST_PAD_PROBE_OK;
+}
+
+/**
+ * \brief Install the frame arena probe on the video sink
+ * \details Like analytics the probe is always installed and checks the
+ *          frame-arena property per query.
+ * 
+ * \param[in] p_mediaplayer - pointer to instance structure
+ * \param[in] p_video_sink  - video sink made by gst_mediaplayer_make_sink
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void gst_mediaplayer_add_arena_probe(GstMediaPlayer *p_mediaplayer, GstElement *p_video_sink)
+{
+    GstPad *p_pad = gst_element_get_static_pad(p_video_sink, "sink");
+
+    gst_pad_add_probe(p_pad, GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM | GST_PAD_PROBE_TYPE_PULL,
+                      gst_mediaplayer_arena_probe, p_mediaplayer, NULL);
+    gst_object_unref(p_pad);
+}
+
+/**
+ * \brief Start exporting frames of the video sink to shared memory
+ * \details Does nothing if no socket path is set.
+ * 
+ * \param[in] p_mediaplayer - pointer to instance structure
+ * \param[in] p_video_sink  - video sink made by gst_mediaplayer_make_sink
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void gst_mediaplayer_start_shm_export(GstMediaPlayer *p_mediaplayer, GstElement *p_video_sink)
+{
+    MediaPlayerShmExport *p_shm_export = NULL;
+    GstPad               *p_pad        = NULL;
+
+    if (p_mediaplayer->p_shm_socket_path && 
+        (p_shm_export = media_player_shm_export_new(p_mediaplayer->p_shm_socket_path, p_mediaplayer->shm_slots)))
+    {
+        GST_OBJECT_LOCK(p_mediaplayer);
+        p_mediaplayer->p_shm_export = p_shm_export;
+        GST_OBJECT_UNLOCK(p_mediaplayer);
+
+        p_pad = gst_element_get_static_pad(p_video_sink, "sink");
+        gst_pad_add_probe(p_pad, GST_PAD_PROBE_TYPE_BUFFER | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+                          gst_mediaplayer_shm_export_probe, p_shm_export, NULL);
+        gst_pad_add_probe(p_pad, GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM | GST_PAD_PROBE_TYPE_PULL,
+                          gst_mediaplayer_shm_allocation_probe, p_shm_export, NULL);
+        gst_object_unref(p_pad);
+    }
+}
+
+/**
+ * \brief Refresh the snapshot duration from the pipeline
+ * \details Only called from the message thread when duration may have changed,
+ *          never on behalf of a reader.
+ * 
+ * \param[in] p_mediaplayer - pointer to instance structure
+ * \param[in] p_pipeline    - pipeline to query
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void gst_mediaplayer_update_duration(GstMediaPlayer *p_mediaplayer, GstElement *p_pipeline)
+{
+    gint64 duration = -1;
+
+    if (gst_element_query_duration(p_pipeline, GST_FORMAT_TIME, &duration) && (duration >= 0))
+    {
+        media_player_snapshot_set_duration(&p_mediaplayer->snapshot, (GstClockTime)duration);
+    }
 }
 
 /**
  * \brief Message Handler for Media Player
+ * \details The thread is detached, so it owns a reference on the instance
+ *          and drops it on exit. Otherwise messages still queued when the
+ *          player is destroyed would be handled against a finalized instance.
  * 
- * \param[in] p_data - generic pointer to mediaplayer plugin instance
+ * \param[in] p_data - generic pointer to mediaplayer plugin instance, reference is transferred
  * 
  * \return gpointer - Generic Return value
  * \author Jason Neitzert
@@ -136,14 +1212,21 @@ static void gst_mediaplayer_init(GstMediaPlayer *p_mediaplayer)
 static gpointer gst_mediaplayer_message_handler(gpointer p_data)
 {
     GstMediaPlayer *p_mediaplayer = (GstMediaPlayer*)p_data;
-    GstBus     *p_bus      = p_mediaplayer->p_bus;
-    GstMessage *p_message  = NULL;
-    GstState    new_state  = GST_STATE_NULL;
-    gboolean    exitThread = FALSE;
+    GstBus     *p_bus        = p_mediaplayer->p_bus;
+    GstElement *p_pipeline   = gst_object_ref(p_mediaplayer->p_pipeline);
+    GstElement *p_video_sink = p_mediaplayer->p_video_sink ? gst_object_ref(p_mediaplayer->p_video_sink) : NULL;
+    GstMessage *p_message    = NULL;
+    GstState    new_state    = GST_STATE_NULL;
+    GstFormat   format       = GST_FORMAT_UNDEFINED;
+    guint64     dropped      = 0;
+    guint64     last_dropped = 0;
+    gboolean    key_units    = FALSE;
+    gboolean    exitThread   = FALSE;
 
     while ((!exitThread) &&
             (p_message = gst_bus_timed_pop_filtered(p_bus, GST_CLOCK_TIME_NONE, GST_MESSAGE_STATE_CHANGED | GST_MESSAGE_ELEMENT | 
-                                                                                GST_MESSAGE_EOS)))
+                                                                                GST_MESSAGE_EOS | GST_MESSAGE_DURATION_CHANGED |
+                                                                                GST_MESSAGE_ASYNC_DONE | GST_MESSAGE_QOS)))
     {
         if (p_message->type == GST_MESSAGE_EOS)
         {
@@ -155,6 +1238,49 @@ static gpointer gst_mediaplayer_message_handler(gpointer p_data)
             {
                 exitThread = TRUE;
             }
+            else if (gst_structure_has_name(gst_message_get_structure(p_message), MEDIA_PLAYER_ANALYTICS_MESSAGE))
+            {
+                g_signal_emit(p_mediaplayer, gst_mediaplayer_signals[SIGNAL_MESSAGE_CALLBACK], 0, p_message);
+            }
+            else if (gst_structure_has_name(gst_message_get_structure(p_message), MEDIA_PLAYER_THROTTLE_MESSAGE))
+            {
+                gst_mediaplayer_apply_throttle(p_mediaplayer, p_pipeline, &key_units);
+            }
+        }
+        else if (p_message->type == GST_MESSAGE_QOS)
+        {
+            /* QoS messages don't mean a frame was dropped, and decoders post their own for frames
+               they skip. Only the video sink's running dropped count is trusted. */
+            if (p_video_sink && ((p_message->src == (GstObject*)p_video_sink) ||
+                                 gst_object_has_as_ancestor(p_message->src, (GstObject*)p_video_sink)))
+            {
+                gst_message_parse_qos_stats(p_message, &format, NULL, &dropped);
+
+                if ((GST_FORMAT_BUFFERS == format) && (dropped != (guint64)-1))
+                {
+                    /* Sink starts counting from 0 again after a flush */
+                    media_player_snapshot_add_dropped(&p_mediaplayer->snapshot,
+                                                      (dropped >= last_dropped) ? (dropped - last_dropped) : dropped);
+                    last_dropped = dropped;
+                }
+            }
+        }
+        else if (p_message->type == GST_MESSAGE_DURATION_CHANGED)
+        {
+            gst_mediaplayer_update_duration(p_mediaplayer, p_pipeline);
+        }
+        else if (p_message->type == GST_MESSAGE_ASYNC_DONE)
+        {
+            /* Seeks need a prerolled pipeline, so catch up on any throttle requested before now */
+            gst_mediaplayer_update_duration(p_mediaplayer, p_pipeline);
+            gst_mediaplayer_apply_throttle(p_mediaplayer, p_pipeline, &key_units);
+        }
+        else if (p_message->src == (GstObject*)p_pipeline)
+        {
+            /* Report the state the pipeline actually reached, as our own state change
+               completes before the pipeline finishes prerolling */
+            gst_message_parse_state_changed(p_message, NULL, &new_state, NULL);
+            media_player_snapshot_set_state(&p_mediaplayer->snapshot, new_state);
         }
         else if (G_OBJECT_TYPE(p_message->src) == GST_TYPE_MEDIA_PLAYER)
         {
@@ -168,6 +1294,12 @@ static gpointer gst_mediaplayer_message_handler(gpointer p_data)
     GST_ERROR("Exiting Message Thread");
 
     gst_object_unref(p_bus);
+    gst_object_unref(p_pipeline);
+    if (p_video_sink)
+    {
+        gst_object_unref(p_video_sink);
+    }
+    gst_object_unref(p_mediaplayer);
 
     return NULL;
 }
@@ -186,7 +1318,10 @@ static GstStateChangeReturn gst_mediaplayer_change_state(GstElement *p_element,
 {
     GstMediaPlayer       *p_mediaplayer    = (GstMediaPlayer*)p_element;
     GstElement           *p_playbin        = NULL;
+    GstElement           *p_video_sink     = NULL;
+    GstElement           *p_audio_sink     = NULL;
     GThread              *p_msg_thread     = NULL;
+    MediaPlayerShmExport *p_shm_export     = NULL;
     GstStateChangeReturn  retval           = GST_STATE_CHANGE_FAILURE;
     GstStateChangeReturn  change_state_ret = GST_STATE_CHANGE_SUCCESS; 
 
@@ -209,14 +1344,30 @@ static GstStateChangeReturn gst_mediaplayer_change_state(GstElement *p_element,
             }
             else
             {
-                g_object_set(p_playbin, "uri",
-                            "https://www.freedesktop.org/software/gstreamer-sdk/data/media/sintel_trailer-480p.webm", NULL);
+                g_object_set(p_playbin, "uri", p_mediaplayer->p_uri, NULL);
+                g_signal_connect(p_playbin, "element-setup", (GCallback)gst_mediaplayer_element_setup, p_mediaplayer);
+
+                /* Provide the sinks ourselves so the snapshot probes can be installed on them.
+                   If one can't be made, playbin will fall back to autoplugging its own. */
+                if ((p_video_sink = gst_mediaplayer_make_sink("autovideosink", &p_mediaplayer->video_sink_probe)))
+                {
+                    gst_mediaplayer_add_analytics_probe(p_mediaplayer, p_video_sink);
+                    gst_mediaplayer_start_shm_export(p_mediaplayer, p_video_sink);
+                    gst_mediaplayer_add_arena_probe(p_mediaplayer, p_video_sink);
+                    g_object_set(p_playbin, "video-sink", p_video_sink, NULL);
+                    p_mediaplayer->p_video_sink = gst_object_ref(p_video_sink);
+                }
+
+                if ((p_audio_sink = gst_mediaplayer_make_sink("autoaudiosink", &p_mediaplayer->audio_sink_probe)))
+                {
+                    g_object_set(p_playbin, "audio-sink", p_audio_sink, NULL);
+                }
                
                 p_mediaplayer->p_bus = gst_element_get_bus(p_mediaplayer->p_pipeline);
                 gst_element_set_bus(p_element, p_mediaplayer->p_bus);
                 
-                /* Create Message handling thread */
-                p_msg_thread = g_thread_new(NULL, gst_mediaplayer_message_handler, p_mediaplayer);            
+                /* Create Message handling thread, it keeps us alive until it has drained the bus */
+                p_msg_thread = g_thread_new(NULL, gst_mediaplayer_message_handler, gst_object_ref(p_mediaplayer));
 
                 /* Unreffing thread here as we will not be doing a join later. This allows shutdown
                    to be quicker as we don't need to wait for thread join to exit. */
@@ -236,7 +1387,12 @@ static GstStateChangeReturn gst_mediaplayer_change_state(GstElement *p_element,
         }
         case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
         {
-            retval = gst_element_set_state(p_mediaplayer->p_pipeline, GST_STATE_PLAYING);
+            /* Stay paused if the governor has us paused. A throttle change racing with us is
+               settled by the message thread, which is told to look again once we are done. */
+            retval = gst_element_set_state(p_mediaplayer->p_pipeline, 
+                                           (MEDIA_PLAYER_THROTTLE_PAUSED == g_atomic_int_get(&p_mediaplayer->throttle)) ?
+                                           GST_STATE_PAUSED : GST_STATE_PLAYING);
+            gst_mediaplayer_post_throttle(p_mediaplayer);
             break;
         }
         default:
@@ -253,6 +1409,7 @@ static GstStateChangeReturn gst_mediaplayer_change_state(GstElement *p_element,
         {
             
             retval = gst_element_set_state(p_mediaplayer->p_pipeline, GST_STATE_PAUSED);
+            gst_mediaplayer_post_throttle(p_mediaplayer);
             break;
         }
         case GST_STATE_CHANGE_PAUSED_TO_READY:
@@ -275,6 +1432,27 @@ static GstStateChangeReturn gst_mediaplayer_change_state(GstElement *p_element,
                unreffed */
 
             gst_object_unref(p_mediaplayer->p_pipeline);
+            gst_mediaplayer_clear_decoders(p_mediaplayer);
+
+            /* Streaming has stopped, so nothing is publishing anymore */
+            GST_OBJECT_LOCK(p_mediaplayer);
+            p_shm_export                = p_mediaplayer->p_shm_export;
+            p_mediaplayer->p_shm_export = NULL;
+            GST_OBJECT_UNLOCK(p_mediaplayer);
+
+            if (p_shm_export)
+            {
+                media_player_shm_export_free(p_shm_export);
+            }
+
+            media_player_snapshot_reset(&p_mediaplayer->snapshot);
+            g_atomic_int_set(&p_mediaplayer->video_positions, FALSE);
+
+            if (p_mediaplayer->p_video_sink)
+            {
+                gst_object_unref(p_mediaplayer->p_video_sink);
+                p_mediaplayer->p_video_sink = NULL;
+            }
 
             break;
         }
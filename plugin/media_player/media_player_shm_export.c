@@ -0,0 +1,1419 @@
+/**
+* \file      media_player_shm_export.c
+* \details   Media Player shared memory frame export implementation. The ring
+*            is a GstAllocator whose memory wraps one slot each, and a buffer
+*            pool binding each of its buffers to a slot is proposed upstream,
+*            so decoders write frames straight into the ring.
+* \author    Jason Neitzert
+* \date      10/19/2026
+* \Copyright Jason Neitzert
+*/
+
+/***************** Includes ********************/
+#define _GNU_SOURCE
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <linux/futex.h>
+#include <gst/video/video.h>
+#include "media_player_shm_export.h"
+
+/***************** Defines *********************/
+#define SHM_EXPORT_LISTEN_BACKLOG 8
+#define SHM_EXPORT_PAGE_SIZE      4096
+
+/* Accept thread poll entries, consumer connections follow these */
+#define SHM_EXPORT_POLL_WAKE      0
+#define SHM_EXPORT_POLL_LISTEN    1
+#define SHM_EXPORT_POLL_CONSUMERS 2
+
+#define SHM_EXPORT_BIT(index) (G_GUINT64_CONSTANT(1) << (index))
+
+/***************** Structures ****************************/
+/* The ring. Memory allocated from it wraps a single slot */
+typedef struct
+{
+    GstAllocator     parent;
+
+    gint             memfd;
+    MpShmRingHeader *p_header;
+    gsize            map_size;
+    guint            slot_count;
+
+    /* Slot bits being written by the producer, either held by a pool buffer or being copied into */
+    guint64          busy;
+
+    /* Slot bits a pool buffer is bound to, protected by the object lock */
+    guint64          bound;
+} MediaPlayerShmRing;
+
+typedef struct
+{
+    GstAllocatorClass parent_class;
+} MediaPlayerShmRingClass;
+
+typedef struct
+{
+    GstMemory mem;
+    guint     slot;
+} MediaPlayerShmMemory;
+
+/* Pool proposed upstream. Each buffer is bound to one slot for its whole life */
+typedef struct
+{
+    GstBufferPool       parent;
+
+    MediaPlayerShmRing *p_ring;
+    GstVideoInfo        info;
+} MediaPlayerShmPool;
+
+typedef struct
+{
+    GstBufferPoolClass parent_class;
+} MediaPlayerShmPoolClass;
+
+struct MediaPlayerShmExport
+{
+    gchar              *p_socket_path;
+    guint               slot_count;
+    gint                listen_fd;
+    gint                wake_fd;
+    GThread            *p_accept_thread;
+
+    /* Protects p_ring and shutdown, accept thread is woken through wake_fd when they change */
+    GMutex              mutex;
+    gboolean            shutdown;
+
+    /* Ring, created on first caps. Only the streaming thread publishes into it */
+    MediaPlayerShmRing *p_ring;
+    GstVideoInfo        info;
+    gboolean            info_valid;
+    guint64             sequence;
+    guint               next_slot;
+
+    /* Connection of each consumer id, -1 if free. Only touched by the accept thread */
+    gint                consumer_fds[MP_SHM_MAX_CONSUMERS];
+
+    /* Written by the streaming thread, read from anywhere */
+    guint64             published;
+    guint64             copied;
+    guint64             dropped;
+};
+
+/***************** Private Global Variables **************/
+static GQuark shm_slot_quark = 0;
+
+/************** Private Functions ****************/
+GType media_player_shm_ring_get_type(void);
+GType media_player_shm_pool_get_type(void);
+G_DEFINE_TYPE(MediaPlayerShmRing, media_player_shm_ring, GST_TYPE_ALLOCATOR)
+G_DEFINE_TYPE(MediaPlayerShmPool, media_player_shm_pool, GST_TYPE_BUFFER_POOL)
+
+/**
+ * \brief Get the start of a slot's frame data
+ *
+ * \param[in] p_ring - pointer to ring
+ * \param[in] slot   - slot index
+ *
+ * \return guint8* - first byte of the slot
+ * \author Jason Neitzert
+ */
+static guint8 *media_player_shm_ring_slot_data(MediaPlayerShmRing *p_ring, guint slot)
+{
+    return (guint8*)p_ring->p_header + p_ring->p_header->slots_offset + (slot * p_ring->p_header->slot_size);
+}
+
+/**
+ * \brief Take ownership of a slot for writing
+ * \details Fails if the slot is already being written, holds the newest
+ *          frame or is leased by a consumer.
+ *
+ * \param[in] p_ring - pointer to ring
+ * \param[in] slot   - slot index
+ *
+ * \return gboolean - TRUE if the slot is now busy and ours to write
+ * \author Jason Neitzert
+ */
+static gboolean media_player_shm_ring_claim_slot(MediaPlayerShmRing *p_ring, guint slot)
+{
+    MpShmSlot *p_slot       = &p_ring->p_header->slots[slot];
+    guint64    latest       = 0;
+    guint64    old_sequence = 0;
+    gboolean   claimed      = FALSE;
+
+    if (!(__atomic_fetch_or(&p_ring->busy, SHM_EXPORT_BIT(slot), __ATOMIC_ACQ_REL) & SHM_EXPORT_BIT(slot)))
+    {
+        /* Only a busy slot is ever published, so latest can't move onto this slot from here on */
+        latest = __atomic_load_n(&p_ring->p_header->latest, __ATOMIC_ACQUIRE);
+
+        /* Never take the newest frame away, so acquiring the latest frame always succeeds */
+        if (!latest || (MP_SHM_LATEST_SLOT(latest) != slot))
+        {
+            old_sequence = __atomic_load_n(&p_slot->sequence, __ATOMIC_RELAXED);
+
+            /* Clear sequence before looking at leases. A consumer that got in first
+               is seen here, one that comes after sees sequence 0 and backs off. */
+            __atomic_store_n(&p_slot->sequence, 0, __ATOMIC_SEQ_CST);
+
+            if (0 == __atomic_load_n(&p_slot->leases, __ATOMIC_SEQ_CST))
+            {
+                claimed = TRUE;
+            }
+            else
+            {
+                __atomic_store_n(&p_slot->sequence, old_sequence, __ATOMIC_RELEASE);
+            }
+        }
+
+        if (!claimed)
+        {
+            __atomic_fetch_and(&p_ring->busy, ~SHM_EXPORT_BIT(slot), __ATOMIC_RELEASE);
+        }
+    }
+
+    return claimed;
+}
+
+/**
+ * \brief Give up writing a slot
+ *
+ * \param[in] p_ring - pointer to ring
+ * \param[in] slot   - slot index claimed with media_player_shm_ring_claim_slot
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void media_player_shm_ring_release_slot(MediaPlayerShmRing *p_ring, guint slot)
+{
+    __atomic_fetch_and(&p_ring->busy, ~SHM_EXPORT_BIT(slot), __ATOMIC_RELEASE);
+}
+
+/**
+ * \brief Find the slot a buffer's frame was written into
+ *
+ * \param[in] p_ring   - pointer to ring
+ * \param[in] p_buffer - buffer to check
+ *
+ * \return gint - slot the buffer's only memory wraps, -1 if it isn't ring memory
+ * \author Jason Neitzert
+ */
+static gint media_player_shm_ring_buffer_slot(MediaPlayerShmRing *p_ring, GstBuffer *p_buffer)
+{
+    GstMemory *p_mem = NULL;
+    gint       slot  = -1;
+
+    if ((1 == gst_buffer_n_memory(p_buffer)) && (p_mem = gst_buffer_peek_memory(p_buffer, 0)) &&
+        (p_mem->allocator == (GstAllocator*)p_ring) && (0 == p_mem->offset))
+    {
+        slot = ((MediaPlayerShmMemory*)p_mem)->slot;
+    }
+
+    return slot;
+}
+
+/**
+ * \brief GstAllocator free for ring memory, the slot itself stays in the ring
+ *
+ * \param[in] p_allocator - the ring
+ * \param[in] p_mem       - memory to free
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void media_player_shm_ring_free(GstAllocator *p_allocator, GstMemory *p_mem)
+{
+    g_slice_free(MediaPlayerShmMemory, (MediaPlayerShmMemory*)p_mem);
+}
+
+/**
+ * \brief Map ring memory, it is always mapped
+ *
+ * \param[in] p_mem   - memory to map
+ * \param[in] maxsize - size to map
+ * \param[in] flags   - map flags
+ *
+ * \return gpointer - start of the slot
+ * \author Jason Neitzert
+ */
+static gpointer media_player_shm_ring_mem_map(GstMemory *p_mem, gsize maxsize, GstMapFlags flags)
+{
+    return media_player_shm_ring_slot_data((MediaPlayerShmRing*)p_mem->allocator, ((MediaPlayerShmMemory*)p_mem)->slot);
+}
+
+/**
+ * \brief Unmap ring memory
+ *
+ * \param[in] p_mem - memory to unmap
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void media_player_shm_ring_mem_unmap(GstMemory *p_mem)
+{
+}
+
+/**
+ * \brief Share part of ring memory without copying
+ *
+ * \param[in] p_mem  - memory to share
+ * \param[in] offset - offset into p_mem to start at
+ * \param[in] size   - size to share, -1 for the rest of p_mem
+ *
+ * \return GstMemory* - memory wrapping the same slot
+ * \author Jason Neitzert
+ */
+static GstMemory *media_player_shm_ring_mem_share(GstMemory *p_mem, gssize offset, gssize size)
+{
+    MediaPlayerShmMemory *p_shared = g_slice_new(MediaPlayerShmMemory);
+    GstMemory            *p_parent = p_mem->parent ? p_mem->parent : p_mem;
+
+    if (-1 == size)
+    {
+        size = p_mem->size - offset;
+    }
+
+    p_shared->slot = ((MediaPlayerShmMemory*)p_mem)->slot;
+
+    gst_memory_init(GST_MEMORY_CAST(p_shared), GST_MINI_OBJECT_FLAGS(p_parent) | GST_MINI_OBJECT_FLAG_LOCK_READONLY,
+                    p_mem->allocator, p_parent, p_mem->maxsize, p_mem->align, p_mem->offset + offset, size);
+
+    return GST_MEMORY_CAST(p_shared);
+}
+
+/**
+ * \brief Finalize for the ring, unmaps it once the last memory is gone
+ *
+ * \param[in] p_object - pointer to instance
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void media_player_shm_ring_finalize(GObject *p_object)
+{
+    MediaPlayerShmRing *p_ring = (MediaPlayerShmRing*)p_object;
+
+    if (p_ring->p_header)
+    {
+        munmap(p_ring->p_header, p_ring->map_size);
+    }
+
+    if (p_ring->memfd >= 0)
+    {
+        close(p_ring->memfd);
+    }
+
+    G_OBJECT_CLASS(media_player_shm_ring_parent_class)->finalize(p_object);
+}
+
+/**
+ * \brief Class init for the ring allocator
+ *
+ * \param[in] p_klass - pointer to class structure
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void media_player_shm_ring_class_init(MediaPlayerShmRingClass *p_klass)
+{
+    GstAllocatorClass *p_allocator_class = (GstAllocatorClass*)p_klass;
+    GObjectClass      *p_object_class    = (GObjectClass*)p_klass;
+
+    /* Memory only comes from the pool binding it to a slot, so there is no alloc */
+    p_allocator_class->free  = media_player_shm_ring_free;
+    p_object_class->finalize = media_player_shm_ring_finalize;
+}
+
+/**
+ * \brief Instance init for the ring allocator
+ *
+ * \param[in] p_ring - pointer to instance structure
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void media_player_shm_ring_init(MediaPlayerShmRing *p_ring)
+{
+    GstAllocator *p_allocator = (GstAllocator*)p_ring;
+
+    p_allocator->mem_type  = MEDIA_PLAYER_SHM_MEMORY_TYPE;
+    p_allocator->mem_map   = media_player_shm_ring_mem_map;
+    p_allocator->mem_unmap = media_player_shm_ring_mem_unmap;
+    p_allocator->mem_share = media_player_shm_ring_mem_share;
+    GST_OBJECT_FLAG_SET(p_ring, GST_ALLOCATOR_FLAG_CUSTOM_ALLOC);
+
+    p_ring->memfd = -1;
+}
+
+/**
+ * \brief Create a ring with slots big enough for frames of a size
+ *
+ * \param[in] slot_count - number of slots
+ * \param[in] frame_size - bytes needed per frame
+ *
+ * \return MediaPlayerShmRing* - the ring, NULL on failure
+ * \author Jason Neitzert
+ */
+static MediaPlayerShmRing *media_player_shm_ring_new(guint slot_count, gsize frame_size)
+{
+    MediaPlayerShmRing *p_ring       = gst_object_ref_sink(g_object_new(media_player_shm_ring_get_type(), NULL));
+    gsize               slot_size    = GST_ROUND_UP_N(frame_size, SHM_EXPORT_PAGE_SIZE);
+    gsize               slots_offset = GST_ROUND_UP_N(sizeof(MpShmRingHeader), SHM_EXPORT_PAGE_SIZE);
+    MpShmRingHeader    *p_header     = MAP_FAILED;
+
+    p_ring->slot_count = slot_count;
+    p_ring->map_size   = slots_offset + (slot_size * slot_count);
+
+    if ((p_ring->memfd = memfd_create("mediaplayer-frames", MFD_CLOEXEC)) < 0)
+    {
+        GST_ERROR("Failed to create memfd: %s", g_strerror(errno));
+    }
+    else if (ftruncate(p_ring->memfd, p_ring->map_size) < 0)
+    {
+        GST_ERROR("Failed to size memfd: %s", g_strerror(errno));
+    }
+    else if (MAP_FAILED == (p_header = mmap(NULL, p_ring->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, p_ring->memfd, 0)))
+    {
+        GST_ERROR("Failed to map memfd: %s", g_strerror(errno));
+    }
+    else
+    {
+        /* Fresh memfd is zero filled, so all slots start out owned by us */
+        p_header->magic        = MP_SHM_MAGIC;
+        p_header->version      = MP_SHM_VERSION;
+        p_header->slot_count   = slot_count;
+        p_header->slot_size    = slot_size;
+        p_header->slots_offset = slots_offset;
+
+        p_ring->p_header = p_header;
+    }
+
+    if (!p_ring->p_header)
+    {
+        gst_object_unref(p_ring);
+        p_ring = NULL;
+    }
+
+    return p_ring;
+}
+
+/**
+ * \brief Get the slot a pool buffer is bound to
+ *
+ * \param[in] p_buffer - buffer from the pool
+ *
+ * \return gint - slot, -1 for a system memory buffer handed out when no slot was free
+ * \author Jason Neitzert
+ */
+static gint media_player_shm_pool_buffer_slot(GstBuffer *p_buffer)
+{
+    return (gint)GPOINTER_TO_UINT(gst_mini_object_get_qdata((GstMiniObject*)p_buffer, shm_slot_quark)) - 1;
+}
+
+/**
+ * \brief Options supported by the pool
+ *
+ * \param[in] p_pool - the pool
+ *
+ * \return const gchar** - NULL terminated options
+ * \author Jason Neitzert
+ */
+static const gchar **media_player_shm_pool_get_options(GstBufferPool *p_pool)
+{
+    static const gchar *p_options[] = {GST_BUFFER_POOL_OPTION_VIDEO_META, GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT, NULL};
+
+    return p_options;
+}
+
+/**
+ * \brief Configure the pool
+ * \details Frames must fit a slot, padding asked for with the video
+ *          alignment option included, and there are only as many buffers as
+ *          slots. Buffers are bound to slots as they are first needed, so
+ *          none are made up front. Configs needing more are refused with the
+ *          most the pool can do, so the caller can fall back to its own pool.
+ *
+ * \param[in] p_pool   - the pool
+ * \param[in] p_config - config to apply
+ *
+ * \return gboolean - TRUE if applied
+ * \author Jason Neitzert
+ */
+static gboolean media_player_shm_pool_set_config(GstBufferPool *p_pool, GstStructure *p_config)
+{
+    MediaPlayerShmPool *p_shm_pool = (MediaPlayerShmPool*)p_pool;
+    MediaPlayerShmRing *p_ring     = p_shm_pool->p_ring;
+    GstCaps            *p_caps     = NULL;
+    GstVideoAlignment   align;
+    guint               size       = 0;
+    guint               min        = 0;
+    guint               max        = 0;
+    gboolean            valid      = FALSE;
+    gboolean            retval     = FALSE;
+
+    valid = gst_buffer_pool_config_get_params(p_config, &p_caps, &size, &min, &max) && p_caps &&
+            gst_video_info_from_caps(&p_shm_pool->info, p_caps);
+
+    if (valid && gst_buffer_pool_config_has_option(p_config, GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT))
+    {
+        /* Offsets and strides of the padded layout go in each buffer's video meta */
+        gst_video_alignment_reset(&align);
+        (void)gst_buffer_pool_config_get_video_alignment(p_config, &align);
+        valid = gst_video_info_align(&p_shm_pool->info, &align);
+    }
+
+    if (!valid)
+    {
+        GST_WARNING("Invalid shared memory pool config");
+    }
+    else if ((MAX(size, GST_VIDEO_INFO_SIZE(&p_shm_pool->info)) > p_ring->p_header->slot_size) ||
+             (GST_VIDEO_INFO_N_PLANES(&p_shm_pool->info) > MP_SHM_MAX_PLANES))
+    {
+        GST_WARNING("Frames of %" GST_PTR_FORMAT " don't fit in shared memory ring", p_caps);
+    }
+    else if (min > p_ring->slot_count)
+    {
+        GST_DEBUG("%u buffers wanted, shared memory ring only has %u", min, p_ring->slot_count);
+        gst_buffer_pool_config_set_params(p_config, p_caps, size, p_ring->slot_count, p_ring->slot_count);
+    }
+    else
+    {
+        gst_buffer_pool_config_set_params(p_config, p_caps, MAX(size, GST_VIDEO_INFO_SIZE(&p_shm_pool->info)),
+                                          0, p_ring->slot_count);
+        retval = GST_BUFFER_POOL_CLASS(media_player_shm_pool_parent_class)->set_config(p_pool, p_config);
+    }
+
+    return retval;
+}
+
+/**
+ * \brief Make a buffer bound to a slot no other pool buffer has
+ *
+ * \param[in]  p_pool    - the pool
+ * \param[out] pp_buffer - the buffer
+ * \param[in]  p_params  - acquire params
+ *
+ * \return GstFlowReturn - GST_FLOW_OK, or GST_FLOW_EOS when every slot is bound
+ * \author Jason Neitzert
+ */
+static GstFlowReturn media_player_shm_pool_alloc_buffer(GstBufferPool *p_pool, GstBuffer **pp_buffer,
+                                                        GstBufferPoolAcquireParams *p_params)
+{
+    MediaPlayerShmPool   *p_shm_pool = (MediaPlayerShmPool*)p_pool;
+    MediaPlayerShmRing   *p_ring     = p_shm_pool->p_ring;
+    GstVideoInfo         *p_info     = &p_shm_pool->info;
+    MediaPlayerShmMemory *p_memory   = NULL;
+    GstFlowReturn         retval     = GST_FLOW_EOS;
+    guint                 slot       = 0;
+
+    GST_OBJECT_LOCK(p_ring);
+    while ((slot < p_ring->slot_count) && (p_ring->bound & SHM_EXPORT_BIT(slot)))
+    {
+        slot++;
+    }
+
+    if (slot < p_ring->slot_count)
+    {
+        p_ring->bound |= SHM_EXPORT_BIT(slot);
+    }
+    GST_OBJECT_UNLOCK(p_ring);
+
+    if (slot < p_ring->slot_count)
+    {
+        p_memory       = g_slice_new(MediaPlayerShmMemory);
+        p_memory->slot = slot;
+        gst_memory_init(GST_MEMORY_CAST(p_memory), 0, (GstAllocator*)p_ring, NULL, p_ring->p_header->slot_size,
+                        0, 0, GST_VIDEO_INFO_SIZE(p_info));
+
+        *pp_buffer = gst_buffer_new();
+        gst_buffer_append_memory(*pp_buffer, GST_MEMORY_CAST(p_memory));
+        gst_buffer_add_video_meta_full(*pp_buffer, GST_VIDEO_FRAME_FLAG_NONE, GST_VIDEO_INFO_FORMAT(p_info),
+                                       GST_VIDEO_INFO_WIDTH(p_info), GST_VIDEO_INFO_HEIGHT(p_info),
+                                       GST_VIDEO_INFO_N_PLANES(p_info), p_info->offset, p_info->stride);
+        gst_mini_object_set_qdata((GstMiniObject*)*pp_buffer, shm_slot_quark, GUINT_TO_POINTER(slot + 1), NULL);
+
+        retval = GST_FLOW_OK;
+    }
+
+    return retval;
+}
+
+/**
+ * \brief Free a pool buffer, unbinding its slot
+ *
+ * \param[in] p_pool   - the pool
+ * \param[in] p_buffer - buffer from media_player_shm_pool_alloc_buffer
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void media_player_shm_pool_free_buffer(GstBufferPool *p_pool, GstBuffer *p_buffer)
+{
+    MediaPlayerShmRing *p_ring = ((MediaPlayerShmPool*)p_pool)->p_ring;
+    gint                slot   = media_player_shm_pool_buffer_slot(p_buffer);
+
+    if (slot >= 0)
+    {
+        GST_OBJECT_LOCK(p_ring);
+        p_ring->bound &= ~SHM_EXPORT_BIT(slot);
+        GST_OBJECT_UNLOCK(p_ring);
+    }
+
+    GST_BUFFER_POOL_CLASS(media_player_shm_pool_parent_class)->free_buffer(p_pool, p_buffer);
+}
+
+/**
+ * \brief Acquire a buffer whose slot can be written
+ * \details Buffers whose slot holds the newest frame or is leased by a
+ *          consumer are skipped. Never waits for consumers: if no slot can be
+ *          written a system memory buffer is handed out instead, and its
+ *          frame goes through the copy path when published.
+ *
+ * \param[in]  p_pool    - the pool
+ * \param[out] pp_buffer - the buffer
+ * \param[in]  p_params  - acquire params
+ *
+ * \return GstFlowReturn - GST_FLOW_OK, or GST_FLOW_FLUSHING while flushing
+ * \author Jason Neitzert
+ */
+static GstFlowReturn media_player_shm_pool_acquire_buffer(GstBufferPool *p_pool, GstBuffer **pp_buffer,
+                                                          GstBufferPoolAcquireParams *p_params)
+{
+    MediaPlayerShmPool         *p_shm_pool   = (MediaPlayerShmPool*)p_pool;
+    GstBufferPoolClass         *p_parent     = GST_BUFFER_POOL_CLASS(media_player_shm_pool_parent_class);
+    GstBuffer                  *p_held[MP_SHM_MAX_SLOTS];
+    GstBuffer                  *p_candidate  = NULL;
+    GstBufferPoolAcquireParams  params       = {0};
+    GstFlowReturn               retval       = GST_FLOW_OK;
+    guint                       held         = 0;
+    guint                       i            = 0;
+
+    if (p_params)
+    {
+        params = *p_params;
+    }
+    params.flags |= GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT;
+
+    *pp_buffer = NULL;
+
+    while (!*pp_buffer && (held < MP_SHM_MAX_SLOTS) &&
+           (GST_FLOW_OK == (retval = p_parent->acquire_buffer(p_pool, &p_candidate, &params))))
+    {
+        if (media_player_shm_ring_claim_slot(p_shm_pool->p_ring, media_player_shm_pool_buffer_slot(p_candidate)))
+        {
+            *pp_buffer = p_candidate;
+        }
+        else
+        {
+            p_held[held++] = p_candidate;
+        }
+    }
+
+    for (i = 0; i < held; i++)
+    {
+        p_parent->release_buffer(p_pool, p_held[i]);
+    }
+
+    if (*pp_buffer)
+    {
+        retval = GST_FLOW_OK;
+    }
+    else if (GST_FLOW_FLUSHING != retval)
+    {
+        GST_DEBUG("Every shared memory slot is held, decoding into system memory");
+
+        *pp_buffer = gst_buffer_new_allocate(NULL, GST_VIDEO_INFO_SIZE(&p_shm_pool->info), NULL);
+        gst_buffer_add_video_meta_full(*pp_buffer, GST_VIDEO_FRAME_FLAG_NONE, GST_VIDEO_INFO_FORMAT(&p_shm_pool->info),
+                                       GST_VIDEO_INFO_WIDTH(&p_shm_pool->info), GST_VIDEO_INFO_HEIGHT(&p_shm_pool->info),
+                                       GST_VIDEO_INFO_N_PLANES(&p_shm_pool->info),
+                                       p_shm_pool->info.offset, p_shm_pool->info.stride);
+        retval = GST_FLOW_OK;
+    }
+
+    return retval;
+}
+
+/**
+ * \brief Take a buffer back into the pool
+ * \details Its slot stops being busy, though it stays protected by being the
+ *          newest frame or leased until the pool claims it again.
+ *
+ * \param[in] p_pool   - the pool
+ * \param[in] p_buffer - buffer being released
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void media_player_shm_pool_release_buffer(GstBufferPool *p_pool, GstBuffer *p_buffer)
+{
+    gint slot = media_player_shm_pool_buffer_slot(p_buffer);
+
+    if (slot < 0)
+    {
+        /* System memory fallback, not ours to keep */
+        gst_buffer_unref(p_buffer);
+    }
+    else
+    {
+        media_player_shm_ring_release_slot(((MediaPlayerShmPool*)p_pool)->p_ring, slot);
+        GST_BUFFER_POOL_CLASS(media_player_shm_pool_parent_class)->release_buffer(p_pool, p_buffer);
+    }
+}
+
+/**
+ * \brief Finalize for the pool
+ *
+ * \param[in] p_object - pointer to instance
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void media_player_shm_pool_finalize(GObject *p_object)
+{
+    gst_object_unref(((MediaPlayerShmPool*)p_object)->p_ring);
+
+    G_OBJECT_CLASS(media_player_shm_pool_parent_class)->finalize(p_object);
+}
+
+/**
+ * \brief Class init for the pool
+ *
+ * \param[in] p_klass - pointer to class structure
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void media_player_shm_pool_class_init(MediaPlayerShmPoolClass *p_klass)
+{
+    GstBufferPoolClass *p_pool_class   = (GstBufferPoolClass*)p_klass;
+    GObjectClass       *p_object_class = (GObjectClass*)p_klass;
+
+    p_pool_class->get_options    = media_player_shm_pool_get_options;
+    p_pool_class->set_config     = media_player_shm_pool_set_config;
+    p_pool_class->alloc_buffer   = media_player_shm_pool_alloc_buffer;
+    p_pool_class->free_buffer    = media_player_shm_pool_free_buffer;
+    p_pool_class->acquire_buffer = media_player_shm_pool_acquire_buffer;
+    p_pool_class->release_buffer = media_player_shm_pool_release_buffer;
+    p_object_class->finalize     = media_player_shm_pool_finalize;
+
+    shm_slot_quark = g_quark_from_static_string("media-player-shm-slot");
+}
+
+/**
+ * \brief Instance init for the pool
+ *
+ * \param[in] p_shm_pool - pointer to instance structure
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void media_player_shm_pool_init(MediaPlayerShmPool *p_shm_pool)
+{
+    gst_video_info_init(&p_shm_pool->info);
+}
+
+/**
+ * \brief Wake the accept thread to look at the ring and shutdown again
+ *
+ * \param[in] p_export - pointer to export
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void shm_export_wake(MediaPlayerShmExport *p_export)
+{
+    guint64 value = 1;
+
+    if (sizeof(value) != write(p_export->wake_fd, &value, sizeof(value)))
+    {
+        GST_ERROR("Failed to wake shared memory accept thread: %s", g_strerror(errno));
+    }
+}
+
+/**
+ * \brief Hand the ring memfd and a consumer id to a consumer
+ *
+ * \param[in] client_fd - connected consumer socket
+ * \param[in] memfd     - memfd of the ring
+ * \param[in] consumer  - id of the consumer
+ *
+ * \return gboolean - TRUE if fd was sent
+ * \author Jason Neitzert
+ */
+static gboolean shm_export_send_hello(gint client_fd, gint memfd, guint consumer)
+{
+    MpShmHello      hello  = {MP_SHM_VERSION, consumer};
+    struct iovec    iov    = {&hello, sizeof(hello)};
+    struct msghdr   msg    = {0};
+    struct cmsghdr *p_cmsg = NULL;
+    union
+    {
+        char           buffer[CMSG_SPACE(sizeof(gint))];
+        struct cmsghdr align;
+    } control;
+
+    memset(&control, 0, sizeof(control));
+    msg.msg_iov        = &iov;
+    msg.msg_iovlen     = 1;
+    msg.msg_control    = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+
+    p_cmsg             = CMSG_FIRSTHDR(&msg);
+    p_cmsg->cmsg_level = SOL_SOCKET;
+    p_cmsg->cmsg_type  = SCM_RIGHTS;
+    p_cmsg->cmsg_len   = CMSG_LEN(sizeof(gint));
+    memcpy(CMSG_DATA(p_cmsg), &memfd, sizeof(gint));
+
+    return (sendmsg(client_fd, &msg, MSG_NOSIGNAL) == sizeof(hello));
+}
+
+/**
+ * \brief Accept a consumer, give it a free id and hand it the ring
+ *
+ * \param[in] p_export - pointer to export
+ * \param[in] p_ring   - the ring
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void shm_export_add_consumer(MediaPlayerShmExport *p_export, MediaPlayerShmRing *p_ring)
+{
+    gint  client_fd = accept4(p_export->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    guint consumer  = 0;
+
+    while ((consumer < MP_SHM_MAX_CONSUMERS) && (p_export->consumer_fds[consumer] >= 0))
+    {
+        consumer++;
+    }
+
+    if (client_fd < 0)
+    {
+        GST_WARNING("Failed to accept shared memory consumer: %s", g_strerror(errno));
+    }
+    else if (consumer >= MP_SHM_MAX_CONSUMERS)
+    {
+        GST_ERROR("Already %d shared memory consumers, refusing another", MP_SHM_MAX_CONSUMERS);
+        close(client_fd);
+    }
+    else if (!shm_export_send_hello(client_fd, p_ring->memfd, consumer))
+    {
+        GST_ERROR("Failed to send frame ring to consumer: %s", g_strerror(errno));
+        close(client_fd);
+    }
+    else
+    {
+        p_export->consumer_fds[consumer] = client_fd;
+    }
+}
+
+/**
+ * \brief Handle activity on a consumer connection
+ * \details Consumers never send anything, so this is a hang up, whether they
+ *          detached or died. Leases it still held are given back to the
+ *          producer, so a crashed consumer can't hold slots forever.
+ *
+ * \param[in] p_export - pointer to export
+ * \param[in] p_ring   - the ring
+ * \param[in] consumer - id of the consumer
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+static void shm_export_check_consumer(MediaPlayerShmExport *p_export, MediaPlayerShmRing *p_ring, guint consumer)
+{
+    gchar  buffer[64];
+    gssize received = recv(p_export->consumer_fds[consumer], buffer, sizeof(buffer), MSG_DONTWAIT);
+    guint  slot     = 0;
+
+    if ((0 == received) || ((received < 0) && (EAGAIN != errno) && (EWOULDBLOCK != errno) && (EINTR != errno)))
+    {
+        for (slot = 0; slot < p_ring->slot_count; slot++)
+        {
+            __atomic_fetch_and(&p_ring->p_header->slots[slot].leases, ~SHM_EXPORT_BIT(consumer), __ATOMIC_SEQ_CST);
+        }
+
+        close(p_export->consumer_fds[consumer]);
+        p_export->consumer_fds[consumer] = -1;
+    }
+}
+
+/**
+ * \brief Accepts consumers and watches their connections
+ * \details Consumers connecting before the first caps wait in the listen
+ *          backlog until the ring exists.
+ *
+ * \param[in] p_data - pointer to MediaPlayerShmExport
+ *
+ * \return gpointer - Generic Return value
+ * \author Jason Neitzert
+ */
+static gpointer shm_export_accept_thread(gpointer p_data)
+{
+    MediaPlayerShmExport *p_export   = (MediaPlayerShmExport*)p_data;
+    MediaPlayerShmRing   *p_ring     = NULL;
+    struct pollfd         fds[SHM_EXPORT_POLL_CONSUMERS + MP_SHM_MAX_CONSUMERS];
+    guint64               wake_count = 0;
+    gboolean              exitThread = FALSE;
+    guint                 consumer   = 0;
+
+    while (!exitThread)
+    {
+        g_mutex_lock(&p_export->mutex);
+        p_ring     = p_export->p_ring;
+        exitThread = p_export->shutdown;
+        g_mutex_unlock(&p_export->mutex);
+
+        /* poll skips negative fds, so the listen socket is only watched once there is a ring */
+        memset(fds, 0, sizeof(fds));
+        fds[SHM_EXPORT_POLL_WAKE].fd       = p_export->wake_fd;
+        fds[SHM_EXPORT_POLL_WAKE].events   = POLLIN;
+        fds[SHM_EXPORT_POLL_LISTEN].fd     = p_ring ? p_export->listen_fd : -1;
+        fds[SHM_EXPORT_POLL_LISTEN].events = POLLIN;
+
+        for (consumer = 0; consumer < MP_SHM_MAX_CONSUMERS; consumer++)
+        {
+            fds[SHM_EXPORT_POLL_CONSUMERS + consumer].fd     = p_export->consumer_fds[consumer];
+            fds[SHM_EXPORT_POLL_CONSUMERS + consumer].events = POLLIN;
+        }
+
+        if (exitThread)
+        {
+            GST_DEBUG("Shared memory accept thread exiting");
+        }
+        else if ((poll(fds, G_N_ELEMENTS(fds), -1) < 0) && (EINTR != errno))
+        {
+            GST_ERROR("Shared memory accept thread failed to poll: %s", g_strerror(errno));
+            exitThread = TRUE;
+        }
+        else
+        {
+            if ((fds[SHM_EXPORT_POLL_WAKE].revents & POLLIN) &&
+                (sizeof(wake_count) != read(p_export->wake_fd, &wake_count, sizeof(wake_count))))
+            {
+                GST_WARNING("Failed to read shared memory accept thread wake: %s", g_strerror(errno));
+            }
+
+            if (fds[SHM_EXPORT_POLL_LISTEN].revents & POLLIN)
+            {
+                shm_export_add_consumer(p_export, p_ring);
+            }
+
+            for (consumer = 0; consumer < MP_SHM_MAX_CONSUMERS; consumer++)
+            {
+                if (fds[SHM_EXPORT_POLL_CONSUMERS + consumer].revents)
+                {
+                    shm_export_check_consumer(p_export, p_ring, consumer);
+                }
+            }
+        }
+    }
+
+    for (consumer = 0; consumer < MP_SHM_MAX_CONSUMERS; consumer++)
+    {
+        if (p_export->consumer_fds[consumer] >= 0)
+        {
+            close(p_export->consumer_fds[consumer]);
+            p_export->consumer_fds[consumer] = -1;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * \brief Take ownership of any slot that can be written
+ *
+ * \param[in] p_export - pointer to export
+ *
+ * \return gint - slot index, or -1 if every slot is busy or held by consumers
+ * \author Jason Neitzert
+ */
+static gint shm_export_claim_slot(MediaPlayerShmExport *p_export)
+{
+    guint index = 0;
+    guint i     = 0;
+    gint  slot  = -1;
+
+    for (i = 0; (i < p_export->slot_count) && (slot < 0); i++)
+    {
+        index = (p_export->next_slot + i) % p_export->slot_count;
+
+        if (media_player_shm_ring_claim_slot(p_export->p_ring, index))
+        {
+            slot = index;
+        }
+    }
+
+    return slot;
+}
+
+/**
+ * \brief Copy a frame from memory outside the ring into a claimed slot
+ *
+ * \param[in] p_export - pointer to export
+ * \param[in] slot     - slot claimed with shm_export_claim_slot
+ * \param[in] p_buffer - decoded frame matching the last caps set
+ *
+ * \return gboolean - TRUE if copied
+ * \author Jason Neitzert
+ */
+static gboolean shm_export_copy_frame(MediaPlayerShmExport *p_export, gint slot, GstBuffer *p_buffer)
+{
+    MediaPlayerShmRing *p_ring        = p_export->p_ring;
+    GstBuffer          *p_slot_buffer = NULL;
+    GstVideoFrame       src_frame;
+    GstVideoFrame       dest_frame;
+    gboolean            retval        = FALSE;
+
+    p_slot_buffer = gst_buffer_new_wrapped_full(0, media_player_shm_ring_slot_data(p_ring, slot), p_ring->p_header->slot_size,
+                                                0, GST_VIDEO_INFO_SIZE(&p_export->info), NULL, NULL);
+
+    if (gst_video_frame_map(&src_frame, &p_export->info, p_buffer, GST_MAP_READ))
+    {
+        if (gst_video_frame_map(&dest_frame, &p_export->info, p_slot_buffer, GST_MAP_WRITE))
+        {
+            /* Lays the frame out with the default strides of info, whatever the source strides */
+            retval = gst_video_frame_copy(&dest_frame, &src_frame);
+            gst_video_frame_unmap(&dest_frame);
+        }
+
+        gst_video_frame_unmap(&src_frame);
+    }
+
+    gst_buffer_unref(p_slot_buffer);
+
+    return retval;
+}
+
+/**
+ * \brief Remove a Unix socket from the filesystem
+ * \details The path comes from a property, so whatever else is there is
+ *          left alone and reported instead of being deleted.
+ *
+ * \param[in] p_socket_path - path of the socket
+ *
+ * \return gboolean - TRUE if nothing is at the path any more
+ * \author Jason Neitzert
+ */
+static gboolean shm_export_remove_socket(const gchar *p_socket_path)
+{
+    struct stat stat_buf;
+    gboolean    removed = TRUE;
+
+    if (0 != lstat(p_socket_path, &stat_buf))
+    {
+        if (ENOENT != errno)
+        {
+            GST_ERROR("Failed to stat %s: %s", p_socket_path, g_strerror(errno));
+            removed = FALSE;
+        }
+    }
+    else if (!S_ISSOCK(stat_buf.st_mode))
+    {
+        GST_ERROR("%s is not a socket, not removing it", p_socket_path);
+        removed = FALSE;
+    }
+    else if ((0 != unlink(p_socket_path)) && (ENOENT != errno))
+    {
+        GST_ERROR("Failed to remove socket %s: %s", p_socket_path, g_strerror(errno));
+        removed = FALSE;
+    }
+
+    return removed;
+}
+
+/***************** Public Functions *************/
+/**
+ * \brief Create a frame export listening for consumers on a Unix socket
+ *
+ * \param[in] p_socket_path - path of Unix socket consumers connect to
+ * \param[in] slot_count    - number of frames in the ring
+ *
+ * \return MediaPlayerShmExport* - new export, NULL on failure
+ * \author Jason Neitzert
+ */
+MediaPlayerShmExport *media_player_shm_export_new(const gchar *p_socket_path, guint slot_count)
+{
+    MediaPlayerShmExport *p_export = g_slice_new0(MediaPlayerShmExport);
+    struct sockaddr_un    address  = {0};
+    guint                 consumer = 0;
+
+    p_export->p_socket_path = g_strdup(p_socket_path);
+    p_export->slot_count    = CLAMP(slot_count, MEDIA_PLAYER_SHM_MIN_SLOTS, MP_SHM_MAX_SLOTS);
+    p_export->listen_fd     = -1;
+    g_mutex_init(&p_export->mutex);
+
+    for (consumer = 0; consumer < MP_SHM_MAX_CONSUMERS; consumer++)
+    {
+        p_export->consumer_fds[consumer] = -1;
+    }
+
+    address.sun_family = AF_UNIX;
+
+    if ((p_export->wake_fd = eventfd(0, EFD_CLOEXEC)) < 0)
+    {
+        GST_ERROR("Failed to create eventfd: %s", g_strerror(errno));
+    }
+    else if (strlen(p_socket_path) >= sizeof(address.sun_path))
+    {
+        GST_ERROR("Socket path too long: %s", p_socket_path);
+    }
+    else if ((p_export->listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+    {
+        GST_ERROR("Failed to create socket: %s", g_strerror(errno));
+    }
+    else
+    {
+        strcpy(address.sun_path, p_socket_path);
+
+        /* Remove a socket left over from a previous run */
+        if (!shm_export_remove_socket(p_socket_path))
+        {
+            close(p_export->listen_fd);
+            p_export->listen_fd = -1;
+        }
+        else if ((bind(p_export->listen_fd, (struct sockaddr*)&address, sizeof(address)) < 0) ||
+                 (listen(p_export->listen_fd, SHM_EXPORT_LISTEN_BACKLOG) < 0))
+        {
+            GST_ERROR("Failed to listen on %s: %s", p_socket_path, g_strerror(errno));
+            close(p_export->listen_fd);
+            p_export->listen_fd = -1;
+        }
+        else
+        {
+            p_export->p_accept_thread = g_thread_new("mp-shm-accept", shm_export_accept_thread, p_export);
+        }
+    }
+
+    if (p_export->listen_fd < 0)
+    {
+        media_player_shm_export_free(p_export);
+        p_export = NULL;
+    }
+
+    return p_export;
+}
+
+/**
+ * \brief Stop exporting, and free the export
+ * \details Consumers still attached keep their mapping and see the ring
+ *          closed. The ring itself lives on until pool buffers using it are gone.
+ *
+ * \param[in] p_export - pointer to export
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+void media_player_shm_export_free(MediaPlayerShmExport *p_export)
+{
+    MpShmRingHeader *p_header = NULL;
+
+    g_mutex_lock(&p_export->mutex);
+    p_export->shutdown = TRUE;
+    g_mutex_unlock(&p_export->mutex);
+
+    if (p_export->p_accept_thread)
+    {
+        shm_export_wake(p_export);
+        g_thread_join(p_export->p_accept_thread);
+    }
+
+    if (p_export->listen_fd >= 0)
+    {
+        close(p_export->listen_fd);
+        (void)shm_export_remove_socket(p_export->p_socket_path);
+    }
+
+    if (p_export->wake_fd >= 0)
+    {
+        close(p_export->wake_fd);
+    }
+
+    if (p_export->p_ring)
+    {
+        p_header = p_export->p_ring->p_header;
+
+        __atomic_store_n(&p_header->closed, 1, __ATOMIC_RELEASE);
+        __atomic_add_fetch(&p_header->frame_futex, 1, __ATOMIC_RELEASE);
+        syscall(SYS_futex, &p_header->frame_futex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+
+        gst_object_unref(p_export->p_ring);
+    }
+
+    g_mutex_clear(&p_export->mutex);
+    g_free(p_export->p_socket_path);
+    g_slice_free(MediaPlayerShmExport, p_export);
+}
+
+/**
+ * \brief Set format of the frames that will be published
+ * \details Ring is sized from the first caps and can't be re-created while
+ *          consumers have it mapped. Renegotiating to frames that don't fit
+ *          a slot is refused, and frames are dropped until caps that fit
+ *          come again.
+ *
+ * \param[in] p_export - pointer to export
+ * \param[in] p_caps   - raw video caps
+ *
+ * \return gboolean - TRUE if frames of these caps can be published
+ * \author Jason Neitzert
+ */
+gboolean media_player_shm_export_set_caps(MediaPlayerShmExport *p_export, GstCaps *p_caps)
+{
+    MediaPlayerShmRing *p_ring = NULL;
+    GstVideoInfo        info;
+
+    if (!gst_video_info_from_caps(&info, p_caps) || (GST_VIDEO_INFO_N_PLANES(&info) > MP_SHM_MAX_PLANES))
+    {
+        GST_ERROR("Can't export frames of %" GST_PTR_FORMAT, p_caps);
+        p_export->info_valid = FALSE;
+    }
+    else if (!p_export->p_ring)
+    {
+        if ((p_ring = media_player_shm_ring_new(p_export->slot_count, GST_VIDEO_INFO_SIZE(&info))))
+        {
+            g_mutex_lock(&p_export->mutex);
+            p_export->p_ring = p_ring;
+            g_mutex_unlock(&p_export->mutex);
+
+            p_export->info       = info;
+            p_export->info_valid = TRUE;
+
+            /* Consumers waiting for the ring can be let in now */
+            shm_export_wake(p_export);
+        }
+        else
+        {
+            p_export->info_valid = FALSE;
+        }
+    }
+    else if (GST_VIDEO_INFO_SIZE(&info) > p_export->p_ring->p_header->slot_size)
+    {
+        GST_ERROR("Renegotiated to %" GST_PTR_FORMAT ", frames don't fit the %" G_GUINT64_FORMAT
+                  " byte shared memory slots, dropping them", p_caps, (guint64)p_export->p_ring->p_header->slot_size);
+        p_export->info_valid = FALSE;
+    }
+    else
+    {
+        p_export->info       = info;
+        p_export->info_valid = TRUE;
+    }
+
+    return p_export->info_valid;
+}
+
+/**
+ * \brief Propose the ring's buffer pool in an ALLOCATION query the sink has answered
+ * \details The sink's own pools are replaced, exporting without a copy takes
+ *          priority over rendering without one. Nothing is proposed before
+ *          the ring exists, for caps of other than system memory, or when
+ *          frames of the query caps don't fit a slot.
+ *
+ * \param[in] p_export - pointer to export
+ * \param[in] p_query  - allocation query on its way back upstream
+ *
+ * \return gboolean - TRUE if the pool was proposed
+ * \author Jason Neitzert
+ */
+gboolean media_player_shm_export_propose_allocation(MediaPlayerShmExport *p_export, GstQuery *p_query)
+{
+    MediaPlayerShmPool *p_shm_pool = NULL;
+    GstBufferPool      *p_pool     = NULL;
+    GstStructure       *p_config   = NULL;
+    GstCaps            *p_caps     = NULL;
+    GstVideoInfo        info;
+    gboolean            need_pool  = FALSE;
+    gboolean            proposed   = FALSE;
+
+    gst_query_parse_allocation(p_query, &p_caps, &need_pool);
+
+    if (p_export->p_ring && p_caps && gst_video_info_from_caps(&info, p_caps) &&
+        gst_caps_features_is_equal(gst_caps_get_features(p_caps, 0), GST_CAPS_FEATURES_MEMORY_SYSTEM_MEMORY) &&
+        (GST_VIDEO_INFO_SIZE(&info) <= p_export->p_ring->p_header->slot_size) &&
+        (GST_VIDEO_INFO_N_PLANES(&info) <= MP_SHM_MAX_PLANES))
+    {
+        p_shm_pool         = gst_object_ref_sink(g_object_new(media_player_shm_pool_get_type(), NULL));
+        p_shm_pool->p_ring = gst_object_ref(p_export->p_ring);
+        p_pool             = (GstBufferPool*)p_shm_pool;
+
+        p_config = gst_buffer_pool_get_config(p_pool);
+        gst_buffer_pool_config_set_params(p_config, p_caps, GST_VIDEO_INFO_SIZE(&info), 0, p_export->slot_count);
+        gst_buffer_pool_config_add_option(p_config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+        (void)gst_buffer_pool_set_config(p_pool, p_config);
+
+        while (gst_query_get_n_allocation_pools(p_query))
+        {
+            gst_query_remove_nth_allocation_pool(p_query, 0);
+        }
+        gst_query_add_allocation_pool(p_query, p_pool, GST_VIDEO_INFO_SIZE(&info), 0, p_export->slot_count);
+
+        if (!gst_query_find_allocation_meta(p_query, GST_VIDEO_META_API_TYPE, NULL))
+        {
+            gst_query_add_allocation_meta(p_query, GST_VIDEO_META_API_TYPE, NULL);
+        }
+
+        gst_object_unref(p_pool);
+        proposed = TRUE;
+    }
+
+    return proposed;
+}
+
+/**
+ * \brief Publish a frame and wake waiting consumers
+ * \details Frames decoded into the ring's pool are published by handing
+ *          over their slot, with the layout their video meta gives, as
+ *          decoders may pad planes. Anything else is copied into a free slot
+ *          with the default layout of the caps and counted as copied.
+ *
+ * \param[in] p_export - pointer to export
+ * \param[in] p_buffer - decoded frame matching the last caps set
+ *
+ * \return gboolean - TRUE if published, FALSE if dropped
+ * \author Jason Neitzert
+ */
+gboolean media_player_shm_export_publish(MediaPlayerShmExport *p_export, GstBuffer *p_buffer)
+{
+    MediaPlayerShmRing *p_ring   = p_export->p_ring;
+    MpShmRingHeader    *p_header = NULL;
+    MpShmSlot          *p_slot   = NULL;
+    GstVideoMeta       *p_meta   = gst_buffer_get_video_meta(p_buffer);
+    struct timespec     now;
+    gint                slot     = -1;
+    guint               plane    = 0;
+    gboolean            claimed  = FALSE;
+    gboolean            retval   = FALSE;
+
+    if (!p_export->info_valid)
+    {
+        GST_LOG("No usable caps, dropping frame");
+    }
+    else if (((slot = media_player_shm_ring_buffer_slot(p_ring, p_buffer)) >= 0) &&
+             (0 == __atomic_load_n(&p_ring->p_header->slots[slot].sequence, __ATOMIC_RELAXED)) &&
+             (p_meta || (gst_buffer_get_size(p_buffer) >= GST_VIDEO_INFO_SIZE(&p_export->info))))
+    {
+        /* Decoded straight into the slot, which stays busy until its buffer goes back to the pool */
+        retval = TRUE;
+    }
+    else if ((slot = shm_export_claim_slot(p_export)) >= 0)
+    {
+        claimed = TRUE;
+
+        if ((retval = shm_export_copy_frame(p_export, slot, p_buffer)))
+        {
+            __atomic_add_fetch(&p_export->copied, 1, __ATOMIC_RELAXED);
+        }
+    }
+
+    if (retval)
+    {
+        p_header = p_ring->p_header;
+        p_slot   = &p_header->slots[slot];
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+
+        p_slot->pts = GST_BUFFER_PTS_IS_VALID(p_buffer) ? (gint64)GST_BUFFER_PTS(p_buffer) : -1;
+
+        if (!claimed && p_meta)
+        {
+            p_slot->width    = p_meta->width;
+            p_slot->height   = p_meta->height;
+            p_slot->n_planes = MIN(p_meta->n_planes, MP_SHM_MAX_PLANES);
+            p_slot->size     = gst_buffer_get_size(p_buffer);
+            g_strlcpy(p_slot->format, gst_video_format_to_string(p_meta->format), MP_SHM_FORMAT_LEN);
+
+            for (plane = 0; plane < p_slot->n_planes; plane++)
+            {
+                p_slot->offsets[plane] = p_meta->offset[plane];
+                p_slot->strides[plane] = p_meta->stride[plane];
+            }
+        }
+        else
+        {
+            p_slot->width    = GST_VIDEO_INFO_WIDTH(&p_export->info);
+            p_slot->height   = GST_VIDEO_INFO_HEIGHT(&p_export->info);
+            p_slot->n_planes = GST_VIDEO_INFO_N_PLANES(&p_export->info);
+            p_slot->size     = GST_VIDEO_INFO_SIZE(&p_export->info);
+            g_strlcpy(p_slot->format, GST_VIDEO_INFO_NAME(&p_export->info), MP_SHM_FORMAT_LEN);
+
+            for (plane = 0; plane < p_slot->n_planes; plane++)
+            {
+                p_slot->offsets[plane] = GST_VIDEO_INFO_PLANE_OFFSET(&p_export->info, plane);
+                p_slot->strides[plane] = GST_VIDEO_INFO_PLANE_STRIDE(&p_export->info, plane);
+            }
+        }
+
+        p_slot->publish_time = ((gint64)now.tv_sec * GST_SECOND) + now.tv_nsec;
+
+        p_export->sequence++;
+        p_export->next_slot = (slot + 1) % p_export->slot_count;
+
+        __atomic_store_n(&p_slot->sequence, p_export->sequence, __ATOMIC_RELEASE);
+        __atomic_store_n(&p_header->latest, MP_SHM_LATEST_PACK(p_export->sequence, slot), __ATOMIC_RELEASE);
+        __atomic_add_fetch(&p_header->frame_futex, 1, __ATOMIC_RELEASE);
+        syscall(SYS_futex, &p_header->frame_futex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+
+        __atomic_add_fetch(&p_export->published, 1, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        __atomic_add_fetch(&p_export->dropped, 1, __ATOMIC_RELAXED);
+    }
+
+    /* A copied slot is protected by being the newest frame from here on */
+    if (claimed)
+    {
+        media_player_shm_ring_release_slot(p_ring, slot);
+    }
+
+    return retval;
+}
+
+/**
+ * \brief Get number of frames published
+ *
+ * \param[in] p_export - pointer to export
+ *
+ * \return guint64 - published frame count, copied ones included
+ * \author Jason Neitzert
+ */
+guint64 media_player_shm_export_get_published(MediaPlayerShmExport *p_export)
+{
+    return __atomic_load_n(&p_export->published, __ATOMIC_RELAXED);
+}
+
+/**
+ * \brief Get number of frames that had to be copied into the ring
+ * \details Non zero when upstream refused the ring's pool, or decoded into
+ *          system memory because consumers held every slot.
+ *
+ * \param[in] p_export - pointer to export
+ *
+ * \return guint64 - copied frame count
+ * \author Jason Neitzert
+ */
+guint64 media_player_shm_export_get_copied(MediaPlayerShmExport *p_export)
+{
+    return __atomic_load_n(&p_export->copied, __ATOMIC_RELAXED);
+}
+
+/**
+ * \brief Get number of frames that could not be published
+ *
+ * \param[in] p_export - pointer to export
+ *
+ * \return guint64 - dropped frame count
+ * \author Jason Neitzert
+ */
+guint64 media_player_shm_export_get_dropped(MediaPlayerShmExport *p_export)
+{
+    return __atomic_load_n(&p_export->dropped, __ATOMIC_RELAXED);
+}
@@ -9,22 +9,95 @@
 #ifndef MEDIA_PLAYER_H
 /***************** Includes *******************************************/
 #include <stdbool.h>
+#include <stdint.h>
 
 /***************** Defines ********************************************/
+#define MP_PROBE_MAX_TRACKS 8
+#define MP_PROBE_NAME_LEN   32
 
 /************************* Structures and Enums ***********************/
 /* Messages Player can Emit */
 typedef enum
 {
-    eMP_EOS /* End of Stream */
+    eMP_EOS,          /* End of Stream */
+    eMP_SCENE_CHANGE, /* Analytics: frame differs a lot from the previous one */
+    eMP_BLACK_FRAME,  /* Analytics: first frame of a run of black frames */
+    eMP_FROZEN_FRAME  /* Analytics: video has stopped changing */
 } MpMessage;
 
+/* States a Player can be in */
+typedef enum
+{
+    eMP_STATE_NULL,
+    eMP_STATE_READY,
+    eMP_STATE_PAUSED,
+    eMP_STATE_PLAYING
+} MpState;
+
+/* How the decode governor is limiting a Player, must match MediaPlayerThrottle */
+typedef enum
+{
+    eMP_THROTTLE_NONE,      /* Every frame decoded */
+    eMP_THROTTLE_KEY_UNITS, /* Only key frames decoded */
+    eMP_THROTTLE_PAUSED     /* Held paused until cores free up */
+} MpThrottle;
+
+/* Where decoded frames are allocated from, must match MediaPlayerArenaMode */
+typedef enum
+{
+    eMP_FRAME_ARENA_OFF,        /* Whatever the video sink proposes */
+    eMP_FRAME_ARENA_ON,         /* Arena shared by all players in the process */
+    eMP_FRAME_ARENA_HUGE_PAGES  /* Huge page backed arena shared by all players in the process */
+} MpFrameArena;
+
+/* Kinds of track media_player_probe can find */
+typedef enum
+{
+    eMP_TRACK_VIDEO,
+    eMP_TRACK_AUDIO,
+    eMP_TRACK_SUBTITLE,
+    eMP_TRACK_OTHER
+} MpTrackType;
+
+/* One track of probed media. Fields that don't apply to the track type are 0. */
+typedef struct
+{
+    MpTrackType type;
+    char        codec[MP_PROBE_NAME_LEN]; /* GStreamer media type, eg "video/x-h264" */
+    int         width;
+    int         height;
+    int         framerate_num;
+    int         framerate_den;
+    int         channels;
+    int         sample_rate;
+} MpTrackInfo;
+
+/* What media_player_probe found out about a file */
+typedef struct
+{
+    int64_t      duration_ns;                  /* -1 if unknown */
+    char         container[MP_PROBE_NAME_LEN]; /* Empty if not reported by the demuxer */
+    unsigned int n_tracks;
+    MpTrackInfo  tracks[MP_PROBE_MAX_TRACKS];
+} MpMediaInfo;
+
+/* Counters of a player's shared memory export since it last left the NULL state */
+typedef struct
+{
+    uint64_t published; /* Frames handed to consumers */
+    uint64_t copied;    /* Published frames decoded outside the ring and copied into it */
+    uint64_t dropped;   /* Frames not published because consumers held every slot */
+} MpShmExportStats;
+
 /***************** Types **********************************************/
 typedef struct MediaPlayer MediaPlayer;
 
 /* Definition of callback used for message handling. */
 typedef void (*MpMessageCallback)(MpMessage message);
 
+/* Definition of callback media_player_probe_scan calls for each media file found */
+typedef void (*MpProbeScanCallback)(const char *p_path, const MpMediaInfo *p_info, void *p_user_data);
+
 /***************** Public Functions ***********************************/
 void media_player_api_init();
 void media_player_api_uninit();
@@ -33,4 +106,33 @@ void media_player_destroy(MediaPlayer *p_media_player);
 
 bool media_player_play(MediaPlayer *p_media_player);
 bool media_player_pause(MediaPlayer *p_media_player);
+
+/* Wait free queries, safe to poll from any thread at UI rate */
+bool media_player_get_position(MediaPlayer *p_media_player, int64_t *p_position_ns);
+bool media_player_get_duration(MediaPlayer *p_media_player, int64_t *p_duration_ns);
+MpState media_player_get_state(MediaPlayer *p_media_player);
+
+void media_player_set_analytics(MediaPlayer *p_media_player, bool enable);
+
+/* Export decoded frames to other processes, see media_player_shm.h. Set before playing. */
+void media_player_set_shm_export(MediaPlayer *p_media_player, const char *p_socket_path, unsigned int slot_count);
+void media_player_get_shm_export_stats(MediaPlayer *p_media_player, MpShmExportStats *p_stats);
+
+/* Set before playing, defaults to the sintel trailer */
+void media_player_set_uri(MediaPlayer *p_media_player, const char *p_uri);
+
+/* Decode governor, shares cores among all players in the process by priority */
+void media_player_governor_set_core_budget(unsigned int cores);
+void media_player_set_priority(MediaPlayer *p_media_player, int priority);
+MpThrottle media_player_get_throttle(MediaPlayer *p_media_player);
+uint64_t media_player_get_dropped_frames(MediaPlayer *p_media_player);
+
+/* Set before playing. Arena memory is kept for reuse, never returned to the OS. */
+void media_player_set_frame_arena(MediaPlayer *p_media_player, MpFrameArena frame_arena);
+
+/* Media discovery without a MediaPlayer. Results are cached by path, mtime and size. */
+bool media_player_probe(const char *p_path, MpMediaInfo *p_info);
+unsigned int media_player_probe_scan(const char *p_directory, MpProbeScanCallback callback, void *p_user_data);
+bool media_player_probe_set_cache(const char *p_cache_path);
+bool media_player_probe_cache_flush();
 #endif
@@ -0,0 +1,50 @@
+/**
+* \file      media_player_shm.h
+* \details   Media Player shared memory frame consumer API. Lets another local
+*            process attach to the frame ring a MediaPlayer exports with
+*            media_player_set_shm_export, and read frames without copying them.
+* \author    Jason Neitzert
+* \date      10/19/2026
+* \Copyright Jason Neitzert 
+*/
+
+#ifndef MEDIA_PLAYER_SHM_H
+#define MEDIA_PLAYER_SHM_H
+/***************** Includes *******************************************/
+#include <stdbool.h>
+#include <stdint.h>
+
+/***************** Defines ********************************************/
+#define MP_SHM_FRAME_MAX_PLANES 4
+#define MP_SHM_FRAME_FORMAT_LEN 16
+
+/************************* Structures and Enums ***********************/
+/* Frame held by a consumer. Data stays valid until media_player_shm_release */
+typedef struct
+{
+    const uint8_t *p_data;       /* Start of frame, planes are at p_data + offsets[n] */
+    uint64_t       size;
+    uint64_t       sequence;     /* Frame number, increases by one per published frame */
+    int64_t        pts;          /* Buffer timestamp in ns, -1 if none */
+    int64_t        publish_time; /* CLOCK_MONOTONIC time frame was published in ns */
+    uint32_t       width;
+    uint32_t       height;
+    uint32_t       n_planes;
+    uint32_t       offsets[MP_SHM_FRAME_MAX_PLANES];
+    uint32_t       strides[MP_SHM_FRAME_MAX_PLANES];
+    char           format[MP_SHM_FRAME_FORMAT_LEN];
+
+    uint32_t       slot;         /* Internal, used to release the frame */
+} MpShmFrame;
+
+/***************** Types **********************************************/
+typedef struct MpShmConsumer MpShmConsumer;
+
+/***************** Public Functions ***********************************/
+MpShmConsumer *media_player_shm_attach(const char *p_socket_path);
+void media_player_shm_detach(MpShmConsumer *p_consumer);
+
+bool media_player_shm_acquire_latest(MpShmConsumer *p_consumer, MpShmFrame *p_frame);
+bool media_player_shm_acquire_next(MpShmConsumer *p_consumer, int timeout_ms, MpShmFrame *p_frame);
+void media_player_shm_release(MpShmConsumer *p_consumer, MpShmFrame *p_frame);
+#endif
@@ -0,0 +1,363 @@
+/*************************************************
+* \file      media_player_shm.c
+* \details   Media Player shared memory frame consumer Implementation.
+*            Only depends on the C library so it can be used by processes
+*            that don't link gstreamer.
+* \author    Jason Neitzert
+* \date      10/19/2026
+* \Copyright Jason Neitzert
+*************************************************/
+
+/***************** Includes *********************/
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/un.h>
+#include <linux/futex.h>
+#include "media_player_shm.h"
+#include "media_player_shm_protocol.h"
+
+/***************** Defines **********************/
+#define NSEC_PER_SEC  1000000000LL
+#define NSEC_PER_MSEC 1000000LL
+
+_Static_assert(MP_SHM_FRAME_MAX_PLANES == MP_SHM_MAX_PLANES, "Plane count must match protocol");
+_Static_assert(MP_SHM_FRAME_FORMAT_LEN == MP_SHM_FORMAT_LEN, "Format length must match protocol");
+
+/***************** Structures and Enums *********/
+struct MpShmConsumer
+{
+   int              sock_fd;  /* Kept open while attached, the producer drops our leases when it closes */
+   int              memfd;
+   MpShmRingHeader *p_header;
+   size_t           map_size;
+   uint64_t         last_sequence;
+   uint64_t         lease_bit;
+   uint32_t         holds[MP_SHM_MAX_SLOTS]; /* Frames acquired per slot, the lease is held while non zero */
+};
+
+/****************** Private Functions *******************/
+/**
+ * \brief Get CLOCK_MONOTONIC time
+ *
+ * \return int64_t - time in ns
+ * \author Jason Neitzert
+ */
+static int64_t shm_now()
+{
+   struct timespec now;
+
+   clock_gettime(CLOCK_MONOTONIC, &now);
+
+   return ((int64_t)now.tv_sec * NSEC_PER_SEC) + now.tv_nsec;
+}
+
+/**
+ * \brief Connect to producer and receive the ring memfd and our consumer id
+ *
+ * \param[in] p_consumer    - pointer to consumer, sock_fd, memfd and lease_bit are set
+ * \param[in] p_socket_path - path of producer Unix socket
+ *
+ * \return bool - true if the ring was received
+ * \author Jason Neitzert
+ */
+static bool shm_receive_fd(MpShmConsumer *p_consumer, const char *p_socket_path)
+{
+   struct sockaddr_un address = {0};
+   MpShmHello         hello   = {0};
+   struct iovec       iov     = {&hello, sizeof(hello)};
+   struct msghdr      msg     = {0};
+   struct cmsghdr    *p_cmsg  = NULL;
+   int                sock_fd = -1;
+   bool               retval  = false;
+   union
+   {
+      char           buffer[CMSG_SPACE(sizeof(int))];
+      struct cmsghdr align;
+   } control;
+
+   memset(&control, 0, sizeof(control));
+   msg.msg_iov        = &iov;
+   msg.msg_iovlen     = 1;
+   msg.msg_control    = control.buffer;
+   msg.msg_controllen = sizeof(control.buffer);
+
+   address.sun_family = AF_UNIX;
+
+   if (strlen(p_socket_path) >= sizeof(address.sun_path))
+   {
+      fprintf(stderr, "media_player_shm: socket path too long\n");
+   }
+   else if ((sock_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+   {
+      fprintf(stderr, "media_player_shm: socket failed: %s\n", strerror(errno));
+   }
+   else
+   {
+      strcpy(address.sun_path, p_socket_path);
+
+      if (connect(sock_fd, (struct sockaddr*)&address, sizeof(address)) < 0)
+      {
+         fprintf(stderr, "media_player_shm: connect to %s failed: %s\n", p_socket_path, strerror(errno));
+      }
+      else if ((recvmsg(sock_fd, &msg, MSG_CMSG_CLOEXEC) != sizeof(hello)) || (MP_SHM_VERSION != hello.version) ||
+               (hello.consumer >= MP_SHM_MAX_CONSUMERS))
+      {
+         fprintf(stderr, "media_player_shm: bad handshake from %s\n", p_socket_path);
+      }
+      else if (!(p_cmsg = CMSG_FIRSTHDR(&msg)) || (SCM_RIGHTS != p_cmsg->cmsg_type) ||
+               (CMSG_LEN(sizeof(int)) != p_cmsg->cmsg_len))
+      {
+         fprintf(stderr, "media_player_shm: no frame ring received from %s\n", p_socket_path);
+      }
+      else
+      {
+         memcpy(&p_consumer->memfd, CMSG_DATA(p_cmsg), sizeof(int));
+         p_consumer->sock_fd   = sock_fd;
+         p_consumer->lease_bit = 1ULL << hello.consumer;
+         retval                = true;
+      }
+
+      if (!retval)
+      {
+         close(sock_fd);
+      }
+   }
+
+   return retval;
+}
+
+/***************** Public Functions *************/
+
+/**
+ * \brief Attach to the frame ring of a MediaPlayer
+ * \details Blocks until the player has negotiated its first video caps. A
+ *          consumer must only be used from one thread at a time. Frames it
+ *          still holds if the process dies are given back by the producer.
+ *
+ * \param[in] p_socket_path - socket path given to media_player_set_shm_export
+ *
+ * \return MpShmConsumer* - consumer, NULL on failure
+ * \author Jason Neitzert
+ */
+MpShmConsumer *media_player_shm_attach(const char *p_socket_path)
+{
+   MpShmConsumer *p_consumer = calloc(1, sizeof(MpShmConsumer));
+   struct stat    stat_buf;
+
+   if (!p_consumer)
+   {
+      fprintf(stderr, "media_player_shm: failed to alloc consumer\n");
+   }
+   else if (!shm_receive_fd(p_consumer, p_socket_path))
+   {
+      free(p_consumer);
+      p_consumer = NULL;
+   }
+   else if ((fstat(p_consumer->memfd, &stat_buf) < 0) || (stat_buf.st_size < (off_t)sizeof(MpShmRingHeader)) ||
+            (MAP_FAILED == (p_consumer->p_header = mmap(NULL, stat_buf.st_size, PROT_READ | PROT_WRITE,
+                                                        MAP_SHARED, p_consumer->memfd, 0))))
+   {
+      fprintf(stderr, "media_player_shm: failed to map frame ring\n");
+      close(p_consumer->sock_fd);
+      close(p_consumer->memfd);
+      free(p_consumer);
+      p_consumer = NULL;
+   }
+   else
+   {
+      p_consumer->map_size = stat_buf.st_size;
+
+      if ((MP_SHM_MAGIC != p_consumer->p_header->magic) || (MP_SHM_VERSION != p_consumer->p_header->version) ||
+          (p_consumer->p_header->slot_count > MP_SHM_MAX_SLOTS) ||
+          ((p_consumer->p_header->slots_offset + (p_consumer->p_header->slot_size * p_consumer->p_header->slot_count)) >
+            p_consumer->map_size))
+      {
+         fprintf(stderr, "media_player_shm: frame ring is not compatible\n");
+         media_player_shm_detach(p_consumer);
+         p_consumer = NULL;
+      }
+   }
+
+   return p_consumer;
+}
+
+/**
+ * \brief Detach from a frame ring. Frames still held are given back.
+ *
+ * \param[in] p_consumer - pointer to consumer
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+void media_player_shm_detach(MpShmConsumer *p_consumer)
+{
+   uint32_t slot = 0;
+
+   for (slot = 0; slot < MP_SHM_MAX_SLOTS; slot++)
+   {
+      if (p_consumer->holds[slot])
+      {
+         __atomic_fetch_and(&p_consumer->p_header->slots[slot].leases, ~p_consumer->lease_bit, __ATOMIC_RELEASE);
+      }
+   }
+
+   munmap(p_consumer->p_header, p_consumer->map_size);
+   close(p_consumer->memfd);
+   close(p_consumer->sock_fd);
+   free(p_consumer);
+}
+
+/**
+ * \brief Acquire the newest frame in the ring
+ * \details Never blocks. Frame must be given back with media_player_shm_release,
+ *          the producer will not reuse its slot until then.
+ *
+ * \param[in]  p_consumer - pointer to consumer
+ * \param[out] p_frame    - the frame
+ *
+ * \return bool - true if a frame was acquired
+ * \author Jason Neitzert
+ */
+bool media_player_shm_acquire_latest(MpShmConsumer *p_consumer, MpShmFrame *p_frame)
+{
+   MpShmRingHeader *p_header = p_consumer->p_header;
+   MpShmSlot       *p_slot   = NULL;
+   uint64_t         latest   = 0;
+   uint64_t         checked  = 0;
+   uint32_t         slot     = 0;
+   bool             acquired = false;
+   bool             leased   = false;
+
+   /* Only loops when the producer publishes again while we are acquiring */
+   while (!acquired && (latest = __atomic_load_n(&p_header->latest, __ATOMIC_ACQUIRE)) && (latest != checked))
+   {
+      checked = latest;
+      slot    = MP_SHM_LATEST_SLOT(latest);
+
+      if (slot < p_header->slot_count)
+      {
+         p_slot = &p_header->slots[slot];
+         leased = (p_consumer->holds[slot] > 0);
+
+         /* Lease the slot before checking it is still the one we want,
+            the producer does the opposite order when claiming a slot */
+         if (!leased)
+         {
+            __atomic_fetch_or(&p_slot->leases, p_consumer->lease_bit, __ATOMIC_SEQ_CST);
+         }
+
+         if (MP_SHM_LATEST_SEQUENCE(latest) == __atomic_load_n(&p_slot->sequence, __ATOMIC_SEQ_CST))
+         {
+            p_consumer->holds[slot]++;
+            acquired = true;
+         }
+         else if (!leased)
+         {
+            __atomic_fetch_and(&p_slot->leases, ~p_consumer->lease_bit, __ATOMIC_RELEASE);
+         }
+      }
+   }
+
+   if (acquired)
+   {
+      p_frame->p_data       = (const uint8_t*)p_header + p_header->slots_offset + (slot * p_header->slot_size);
+      p_frame->size         = p_slot->size;
+      p_frame->sequence     = MP_SHM_LATEST_SEQUENCE(latest);
+      p_frame->pts          = p_slot->pts;
+      p_frame->publish_time = p_slot->publish_time;
+      p_frame->width        = p_slot->width;
+      p_frame->height       = p_slot->height;
+      p_frame->n_planes     = p_slot->n_planes;
+      p_frame->slot         = slot;
+      memcpy(p_frame->offsets, p_slot->offsets, sizeof(p_frame->offsets));
+      memcpy(p_frame->strides, p_slot->strides, sizeof(p_frame->strides));
+      memcpy(p_frame->format, p_slot->format, sizeof(p_frame->format));
+      p_frame->format[MP_SHM_FRAME_FORMAT_LEN - 1] = '\0';
+
+      p_consumer->last_sequence = p_frame->sequence;
+   }
+
+   return acquired;
+}
+
+/**
+ * \brief Acquire a frame newer than the last one this consumer acquired
+ * \details If the consumer fell behind, frames in between are skipped and
+ *          the newest one is returned.
+ *
+ * \param[in]  p_consumer - pointer to consumer
+ * \param[in]  timeout_ms - max time to wait, negative to wait forever
+ * \param[out] p_frame    - the frame
+ *
+ * \return bool - true if a frame was acquired, false on timeout or producer stopped
+ * \author Jason Neitzert
+ */
+bool media_player_shm_acquire_next(MpShmConsumer *p_consumer, int timeout_ms, MpShmFrame *p_frame)
+{
+   MpShmRingHeader *p_header  = p_consumer->p_header;
+   int64_t          deadline  = shm_now() + (timeout_ms * NSEC_PER_MSEC);
+   int64_t          remaining = 0;
+   uint32_t         futex_val = 0;
+   bool             acquired  = false;
+   bool             done      = false;
+   struct timespec  timeout;
+
+   while (!done)
+   {
+      /* Read futex before latest, so a publish in between makes the wait return at once */
+      futex_val = __atomic_load_n(&p_header->frame_futex, __ATOMIC_ACQUIRE);
+
+      if ((MP_SHM_LATEST_SEQUENCE(__atomic_load_n(&p_header->latest, __ATOMIC_ACQUIRE)) > p_consumer->last_sequence) &&
+          media_player_shm_acquire_latest(p_consumer, p_frame))
+      {
+         acquired = true;
+         done     = true;
+      }
+      else if (__atomic_load_n(&p_header->closed, __ATOMIC_ACQUIRE))
+      {
+         done = true;
+      }
+      else if ((timeout_ms >= 0) && ((remaining = deadline - shm_now()) <= 0))
+      {
+         done = true;
+      }
+      else
+      {
+         timeout.tv_sec  = remaining / NSEC_PER_SEC;
+         timeout.tv_nsec = remaining % NSEC_PER_SEC;
+
+         (void)syscall(SYS_futex, &p_header->frame_futex, FUTEX_WAIT, futex_val,
+                       (timeout_ms >= 0) ? &timeout : NULL, NULL, 0);
+      }
+   }
+
+   return acquired;
+}
+
+/**
+ * \brief Give a frame back to the producer
+ *
+ * \param[in] p_consumer - pointer to consumer
+ * \param[in] p_frame    - frame from media_player_shm_acquire_latest/_next
+ *
+ * \return void
+ * \author Jason Neitzert
+ */
+void media_player_shm_release(MpShmConsumer *p_consumer, MpShmFrame *p_frame)
+{
+   if (0 == --p_consumer->holds[p_frame->slot])
+   {
+      __atomic_fetch_and(&p_consumer->p_header->slots[p_frame->slot].leases, ~p_consumer->lease_bit, __ATOMIC_RELEASE);
+   }
+
+   p_frame->p_data = NULL;
+}
@@ -9,15 +9,143 @@
 
 /************************* Includes *************************/
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
+#include <time.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
 #include <CUnit/Console.h>
 #include <glib-2.0/glib.h>
+#include <gst/video/video.h>
 #include "media_player_api.h"
+#include "media_player_analytics.h"
+#include "media_player_arena.h"
+#include "media_player_shm.h"
+#include "media_player_snapshot.h"
+
+/************************* Defines **************************/
+/* Snapshot benchmark simulates a UI polling playing players every frame, against
+   querying the pipelines directly. Live players compare per query cost, the scale
+   run polls SNAPSHOT_BENCH_SNAPSHOTS snapshots kept busy by a writer thread */
+#define SNAPSHOT_BENCH_MEDIA_PATH "/tmp/media_player_snapshot_bench.mkv"
+#define SNAPSHOT_BENCH_PLAYERS    8
+#define SNAPSHOT_BENCH_SNAPSHOTS  1000
+#define SNAPSHOT_BENCH_POLL_HZ    60
+#define SNAPSHOT_BENCH_TICKS      600
+
+/* Analytics kernels are measured on 1080p luma planes */
+#define ANALYTICS_BENCH_WIDTH      1920
+#define ANALYTICS_BENCH_HEIGHT     1080
+#define ANALYTICS_BENCH_ITERATIONS 100
+
+/* Shared memory export tests play white frames so pixel content can be checked */
+#define SHM_TEST_MEDIA_PATH  "/tmp/media_player_shm_test.mkv"
+#define SHM_TEST_SOCKET_PATH "/tmp/media_player_shm_test.sock"
+#define SHM_TEST_WIDTH       320
+#define SHM_TEST_HEIGHT      240
+#define SHM_TEST_SLOTS       16
+#define SHM_TEST_CRASH_SLOTS 4
+#define SHM_TEST_FRAMES      10
+#define SHM_TEST_TIMEOUT_MS  5000
+#define SHM_TEST_NOT_SOCKET  "Not a socket, must survive the player"
+
+/* Shared memory consumers run in their own test_app process, started with these arguments */
+#define SHM_CONSUMER_CHILD_ARG "--shm-consumer"
+#define SHM_CONSUMER_HOLD      "hold"
+#define SHM_CONSUMER_BENCH     "bench"
+#define SHM_CONSUMER_HELD      "SHM_CONSUMER_HELD"
+#define SHM_CONSUMER_RESULT    "SHM_CONSUMER_RESULT"
+
+/* Shared memory export benchmark, one playing player and several consumer processes */
+#define SHM_BENCH_MEDIA_PATH  "/tmp/media_player_shm_bench.mkv"
+#define SHM_BENCH_SOCKET_PATH "/tmp/media_player_shm_bench.sock"
+#define SHM_BENCH_CONSUMERS   4
+#define SHM_BENCH_SLOTS       8
+#define SHM_BENCH_SECONDS     3
+
+/* Frames of media generated for tests, 10s at 60fps */
+#define TEST_MEDIA_FRAMES 600
+
+/* Governor test oversubscribes the cores with low priority 1080p60 players */
+#define GOVERNOR_TEST_MEDIA_PATH     "/tmp/media_player_governor_test.mkv"
+#define GOVERNOR_TEST_CORE_BUDGET    2
+#define GOVERNOR_TEST_LOW_PLAYERS    8
+#define GOVERNOR_TEST_SETTLE_SECONDS 1
+#define GOVERNOR_TEST_SECONDS        5
+
+/* Frame arena test, a few seconds of 1080p60 per player */
+#define ARENA_TEST_MEDIA_PATH "/tmp/media_player_arena_test.mkv"
+#define ARENA_TEST_FRAMES     180
+#define ARENA_TEST_PLAYERS    2
+#define ARENA_TEST_SECONDS    1
+#define ARENA_TEST_BLOCK_SIZE (1920 * 1080 * 3 / 2)
+
+/* Frame arena benchmark runs each configuration in a fresh test_app process, so memory numbers don't mix */
+#define ARENA_BENCH_MEDIA_PATH   "/tmp/media_player_arena_bench.mkv"
+#define ARENA_BENCH_CHILD_ARG    "--arena-bench"
+#define ARENA_BENCH_RESULT       "ARENA_BENCH_RESULT"
+#define ARENA_BENCH_ROUNDS       2
+#define ARENA_BENCH_SECONDS      3
+#define ARENA_BENCH_MAX_PLAYERS  50
+
+/* Probe scan benchmark scans a library of copies of short generated files in
+   several containers and codecs, mixed with files that aren't media */
+#define PROBE_MEDIA_PATH          "/tmp/media_player_probe_test.mkv"
+#define PROBE_MEDIA_FRAMES        30
+#define PROBE_BENCH_DIRECTORY     "/tmp/media_player_probe_bench"
+#define PROBE_BENCH_SOURCE_PATH   "/tmp/media_player_probe_bench_source"
+#define PROBE_BENCH_CACHE_PATH    "/tmp/media_player_probe_bench.cache"
+#define PROBE_BENCH_SUBDIRS       10
+#define PROBE_BENCH_FILES         1000
+#define PROBE_BENCH_RANDOM_BYTES  (64 * 1024)
+
+/************************* Structures ************************/
+/* Snapshot scale bench writer thread, standing in for that many sink probes */
+typedef struct
+{
+    MediaPlayerSnapshot *p_snapshots;
+    gint                 stop;
+    guint64              passes;
+} SnapshotBenchWriter;
+
+/* What each shared memory bench consumer process reports back */
+typedef struct
+{
+    guint64 frames;
+    gint64  total_latency;
+    gint64  max_latency;
+} ShmBenchResult;
+
+/* One kind of file in the probe scan bench library, launch is NULL for files that aren't media */
+typedef struct
+{
+    const gchar *p_extension;
+    const gchar *p_launch; /* Pipeline writing the media, with %s for the file */
+} ProbeBenchKind;
+
+/* What each frame arena bench process reports back */
+typedef struct
+{
+    guint64 rss_kb;       /* Resident after the last round's players are destroyed */
+    guint64 peak_rss_kb;
+    guint64 page_faults;
+    guint64 allocs;       /* GstMemory allocations from system memory */
+    guint64 alloc_bytes;
+    guint64 arena_allocs; /* Blocks handed out by the arena the players used */
+    gdouble seconds;
+} ArenaBenchResult;
 
 /************************* Private Global Variables ***********/
 static GCond  eos_cond;
 static GMutex eos_mutex;
 
+/* Frame arena bench counts system memory allocations by wrapping the sysmem allocator */
+static GstMemory *(*p_sysmem_alloc)(GstAllocator*, gsize, GstAllocationParams*) = NULL;
+static guint64 sysmem_allocs      = 0;
+static guint64 sysmem_alloc_bytes = 0;
+
 /************************* Private Functions ******************/
 /**
  * \brief   An example for testing memory leaks
@@ -48,9 +176,13 @@ static void example_test_playback_memory()
 
 static void media_player_message_callback(MpMessage message)
 {
-    g_mutex_lock(&eos_mutex);
-    g_cond_signal(&eos_cond);
-    g_mutex_unlock(&eos_mutex);
+    /* Analytics messages come through here too, only EOS ends the wait */
+    if (eMP_EOS == message)
+    {
+        g_mutex_lock(&eos_mutex);
+        g_cond_signal(&eos_cond);
+        g_mutex_unlock(&eos_mutex);
+    }
 }
 
 static MediaPlayer *test_create_mediaplayer()
@@ -150,34 +282,1633 @@ static void unit_test_pause()
     }    
 }
 
+/**
+ * \brief  Test Mediaplayer Position, Duration and State queries
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void unit_test_position()
+{
+    MediaPlayer *p_media_player = test_create_mediaplayer();
+    int64_t      position       = 0;
+    int64_t      duration       = 0;
 
-/************************* Public Functions ******************/
+    if (p_media_player)
+    {
+        CU_ASSERT(eMP_STATE_NULL == media_player_get_state(p_media_player));
+        CU_ASSERT_FALSE(media_player_get_position(p_media_player, &position));
+
+        if (test_media_player_play(p_media_player))
+        {
+            CU_ASSERT(eMP_STATE_PLAYING == media_player_get_state(p_media_player));
+            CU_ASSERT(media_player_get_position(p_media_player, &position));
+            CU_ASSERT(media_player_get_duration(p_media_player, &duration));
+            CU_ASSERT(position > 0);
+            CU_ASSERT(duration >= position);
+        }
+
+        media_player_destroy(p_media_player);
+    }
+}
 
 /**
- * \brief  Main(Need I say more)
+ * \brief  Generate test media with a gst-launch style pipeline
  * 
- * \return int - value you would like process to return on exit
+ * \param[in] p_launch - pipeline description, ending in a filesink
+ * 
+ * \return bool - true if the pipeline ran to EOS
  * \author Jason Neitzert
  */
-int main()
+static bool test_generate_launch(const gchar *p_launch)
 {
-    CU_Suite *p_media_player_suite        = NULL;
-    CU_Suite *p_media_player_memory_suite = NULL;
+    GstElement *p_pipeline = NULL;
+    GstMessage *p_message  = NULL;
+    GError     *p_error    = NULL;
+    bool        generated  = false;
 
-    if (CUE_SUCCESS != CU_initialize_registry())
+    if (!(p_pipeline = gst_parse_launch(p_launch, &p_error)))
     {
-        printf("\nFailed To Init CUnit");
+        printf("\nFailed to generate test media: %s\n", p_error->message);
+        g_error_free(p_error);
     }
     else
     {
-        /* All the tests here will use media player library */
-        media_player_api_init();
-        
-        /* Add suite and tests for general playback */
-        p_media_player_suite = CU_add_suite("media_player_tests", NULL, NULL);
-        CU_add_test(p_media_player_suite, "Playback", unit_test_play);
-        CU_add_test(p_media_player_suite, "Pause", unit_test_pause);
-        CU_add_test(p_media_player_suite, "EOS", unit_test_eos);
+        (void)gst_element_set_state(p_pipeline, GST_STATE_PLAYING);
+
+        p_message = gst_bus_timed_pop_filtered(GST_ELEMENT_BUS(p_pipeline), GST_CLOCK_TIME_NONE,
+                                               GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+        generated = (GST_MESSAGE_EOS == GST_MESSAGE_TYPE(p_message));
+
+        gst_message_unref(p_message);
+        (void)gst_element_set_state(p_pipeline, GST_STATE_NULL);
+        gst_object_unref(p_pipeline);
+    }
+
+    return generated;
+}
+
+/**
+ * \brief  Generate 1080p60 test media with videotestsrc
+ * 
+ * \param[in] p_path      - file to write
+ * \param[in] num_buffers - number of frames to write
+ * 
+ * \return bool - true if media was written
+ * \author Jason Neitzert
+ */
+static bool test_generate_media(const gchar *p_path, guint num_buffers)
+{
+    gchar *p_launch  = g_strdup_printf("videotestsrc num-buffers=%u pattern=ball ! "
+                                       "video/x-raw,width=1920,height=1080,framerate=60/1 ! "
+                                       "jpegenc ! matroskamux ! filesink location=%s", num_buffers, p_path);
+    bool   generated = test_generate_launch(p_launch);
+
+    g_free(p_launch);
+
+    return generated;
+}
+
+/**
+ * \brief  Generate small white 60fps test media for the shared memory tests
+ * 
+ * \return bool - true if media was written
+ * \author Jason Neitzert
+ */
+static bool test_generate_shm_media()
+{
+    gchar *p_launch  = g_strdup_printf("videotestsrc num-buffers=%u pattern=white ! "
+                                       "video/x-raw,width=%d,height=%d,framerate=60/1 ! "
+                                       "jpegenc ! matroskamux ! filesink location=%s",
+                                       TEST_MEDIA_FRAMES, SHM_TEST_WIDTH, SHM_TEST_HEIGHT, SHM_TEST_MEDIA_PATH);
+    bool   generated = test_generate_launch(p_launch);
+
+    g_free(p_launch);
+
+    return generated;
+}
+
+/**
+ * \brief  Test the frame arenas directly and through players
+ * \details Checks a freed block is handed out again, that a second player
+ *          decodes into blocks the first one freed, and that the huge page
+ *          arena falls back to normal pages when none are reserved.
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void unit_test_frame_arena()
+{
+    MediaPlayer  *p_player          = NULL;
+    GstPlugin    *p_plugin          = NULL;
+    GstAllocator *p_arena           = NULL;
+    GstMemory    *p_memory          = NULL;
+    GstMapInfo    map;
+    gpointer      p_data            = NULL;
+    gchar        *p_uri             = NULL;
+    gchar        *p_nr_hugepages    = NULL;
+    guint64       start_allocations = 0;
+    guint64       start_reused      = 0;
+    guint64       allocations       = 0;
+    guint64       reused            = 0;
+    guint         chunks            = 0;
+    guint         hugetlb_chunks    = 0;
+    guint         i                 = 0;
+
+    CU_ASSERT_FATAL(test_generate_media(ARENA_TEST_MEDIA_PATH, ARENA_TEST_FRAMES));
+    p_uri = gst_filename_to_uri(ARENA_TEST_MEDIA_PATH, NULL);
+
+    /* Arenas are registered when the plugin loads */
+    CU_ASSERT_PTR_NOT_NULL_FATAL(p_plugin = gst_plugin_load_by_name("mediaplayer"));
+    gst_object_unref(p_plugin);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(p_arena = gst_allocator_find(MEDIA_PLAYER_ARENA_NAME));
+
+    /* A freed block goes back on the free list and is the next one handed out */
+    g_object_get(p_arena, "allocations", &start_allocations, "reused", &start_reused, NULL);
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(p_memory = gst_allocator_alloc(p_arena, ARENA_TEST_BLOCK_SIZE, NULL));
+    CU_ASSERT(gst_memory_is_type(p_memory, MEDIA_PLAYER_ARENA_MEMORY_TYPE));
+    CU_ASSERT_FATAL(gst_memory_map(p_memory, &map, GST_MAP_WRITE));
+    memset(map.data, 0xA5, map.size);
+    p_data = map.data;
+    gst_memory_unmap(p_memory, &map);
+    gst_memory_unref(p_memory);
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(p_memory = gst_allocator_alloc(p_arena, ARENA_TEST_BLOCK_SIZE, NULL));
+    CU_ASSERT_FATAL(gst_memory_map(p_memory, &map, GST_MAP_READ));
+    CU_ASSERT(map.data == p_data);
+    gst_memory_unmap(p_memory, &map);
+    gst_memory_unref(p_memory);
+
+    g_object_get(p_arena, "allocations", &allocations, "reused", &reused, NULL);
+    CU_ASSERT(2 == (allocations - start_allocations));
+    CU_ASSERT(1 == (reused - start_reused));
+
+    /* Every player must decode into the arena, and later ones into blocks earlier ones freed */
+    for (i = 0; i < ARENA_TEST_PLAYERS; i++)
+    {
+        g_object_get(p_arena, "allocations", &start_allocations, "reused", &start_reused, NULL);
+
+        CU_ASSERT_PTR_NOT_NULL_FATAL(p_player = media_player_new(NULL));
+        media_player_set_uri(p_player, p_uri);
+        media_player_set_frame_arena(p_player, eMP_FRAME_ARENA_ON);
+        CU_ASSERT(media_player_play(p_player));
+        sleep(ARENA_TEST_SECONDS);
+        media_player_destroy(p_player);
+
+        g_object_get(p_arena, "allocations", &allocations, "reused", &reused, NULL);
+        printf("\nArena player %u: %" G_GUINT64_FORMAT " blocks, %" G_GUINT64_FORMAT " reused",
+               i, allocations - start_allocations, reused - start_reused);
+
+        CU_ASSERT(allocations > start_allocations);
+        if (i)
+        {
+            CU_ASSERT(reused > start_reused);
+        }
+    }
+
+    gst_object_unref(p_arena);
+
+    /* Huge page arena still has to hand out memory when no huge pages are reserved */
+    CU_ASSERT_PTR_NOT_NULL_FATAL(p_arena = gst_allocator_find(MEDIA_PLAYER_ARENA_HUGE_PAGES_NAME));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(p_memory = gst_allocator_alloc(p_arena, ARENA_TEST_BLOCK_SIZE, NULL));
+    CU_ASSERT_FATAL(gst_memory_map(p_memory, &map, GST_MAP_WRITE));
+    memset(map.data, 0xA5, map.size);
+    gst_memory_unmap(p_memory, &map);
+    gst_memory_unref(p_memory);
+
+    g_object_get(p_arena, "chunks", &chunks, "hugetlb-chunks", &hugetlb_chunks, NULL);
+    printf("\nHuge page arena: %u chunks, %u of explicit huge pages\n", chunks, hugetlb_chunks);
+
+    CU_ASSERT(chunks >= 1);
+    CU_ASSERT(hugetlb_chunks <= chunks);
+    if (g_file_get_contents("/proc/sys/vm/nr_hugepages", &p_nr_hugepages, NULL, NULL))
+    {
+        if (!g_ascii_strtoull(p_nr_hugepages, NULL, 10))
+        {
+            CU_ASSERT(0 == hugetlb_chunks);
+        }
+
+        g_free(p_nr_hugepages);
+    }
+
+    gst_object_unref(p_arena);
+    g_free(p_uri);
+    (void)unlink(ARENA_TEST_MEDIA_PATH);
+}
+
+/**
+ * \brief  Test decode governor keeps a high priority player smooth
+ * \details Pins the core budget to GOVERNOR_TEST_CORE_BUDGET and plays
+ *          GOVERNOR_TEST_LOW_PLAYERS low priority 1080p60 players, each
+ *          estimated at a core, then a high priority one. Every low priority
+ *          player past the budget must be throttled and those held paused
+ *          must not move, while the high priority player plays in real time
+ *          without being throttled or dropping a frame.
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void unit_test_governor()
+{
+    MediaPlayer *p_low_players[GOVERNOR_TEST_LOW_PLAYERS]  = {NULL};
+    gint64       low_positions[GOVERNOR_TEST_LOW_PLAYERS]  = {0};
+    MediaPlayer *p_high_player = NULL;
+    gchar       *p_uri         = NULL;
+    gint64       high_position = 0;
+    gint64       position      = 0;
+    gint64       start_time    = 0;
+    gint64       elapsed       = 0;
+    guint        throttled     = 0;
+    guint        paused        = 0;
+    guint        i             = 0;
+
+    CU_ASSERT_FATAL(test_generate_media(GOVERNOR_TEST_MEDIA_PATH, TEST_MEDIA_FRAMES));
+    p_uri = gst_filename_to_uri(GOVERNOR_TEST_MEDIA_PATH, NULL);
+
+    media_player_governor_set_core_budget(GOVERNOR_TEST_CORE_BUDGET);
+
+    for (i = 0; i < GOVERNOR_TEST_LOW_PLAYERS; i++)
+    {
+        CU_ASSERT_PTR_NOT_NULL_FATAL(p_low_players[i] = media_player_new(NULL));
+        media_player_set_uri(p_low_players[i], p_uri);
+        media_player_set_priority(p_low_players[i], 0);
+        CU_ASSERT(media_player_play(p_low_players[i]));
+    }
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(p_high_player = media_player_new(NULL));
+    media_player_set_uri(p_high_player, p_uri);
+    media_player_set_priority(p_high_player, 1);
+    CU_ASSERT(media_player_play(p_high_player));
+
+    /* Give the message threads time to apply the throttles */
+    sleep(GOVERNOR_TEST_SETTLE_SECONDS);
+
+    for (i = 0; i < GOVERNOR_TEST_LOW_PLAYERS; i++)
+    {
+        (void)media_player_get_position(p_low_players[i], &low_positions[i]);
+    }
+    CU_ASSERT(media_player_get_position(p_high_player, &high_position));
+    start_time = g_get_monotonic_time();
+
+    sleep(GOVERNOR_TEST_SECONDS);
+
+    CU_ASSERT(media_player_get_position(p_high_player, &position));
+    elapsed       = (g_get_monotonic_time() - start_time) * 1000;
+    high_position = position - high_position;
+
+    for (i = 0; i < GOVERNOR_TEST_LOW_PLAYERS; i++)
+    {
+        if (eMP_THROTTLE_NONE != media_player_get_throttle(p_low_players[i]))
+        {
+            throttled++;
+        }
+
+        if (eMP_THROTTLE_PAUSED == media_player_get_throttle(p_low_players[i]))
+        {
+            paused++;
+            position = low_positions[i];
+            (void)media_player_get_position(p_low_players[i], &position);
+            CU_ASSERT(position == low_positions[i]);
+        }
+    }
+
+    printf("\nGovernor: budget %u cores, %u low priority players, %u throttled (%u paused), "
+           "high priority player played %.2fs in %.2fs and dropped %" G_GUINT64_FORMAT " frames\n",
+           GOVERNOR_TEST_CORE_BUDGET, GOVERNOR_TEST_LOW_PLAYERS, throttled, paused,
+           (gdouble)high_position / GST_SECOND, (gdouble)elapsed / GST_SECOND,
+           (guint64)media_player_get_dropped_frames(p_high_player));
+
+    /* High priority player takes a core of the budget, so only the rest is left for low priority ones */
+    CU_ASSERT(throttled >= (GOVERNOR_TEST_LOW_PLAYERS - (GOVERNOR_TEST_CORE_BUDGET - 1)));
+    CU_ASSERT(paused > 0);
+
+    CU_ASSERT(eMP_THROTTLE_NONE == media_player_get_throttle(p_high_player));
+    CU_ASSERT(eMP_STATE_PLAYING == media_player_get_state(p_high_player));
+    CU_ASSERT(high_position >= ((elapsed * 9) / 10));
+    CU_ASSERT(0 == media_player_get_dropped_frames(p_high_player));
+
+    media_player_destroy(p_high_player);
+    for (i = 0; i < GOVERNOR_TEST_LOW_PLAYERS; i++)
+    {
+        media_player_destroy(p_low_players[i]);
+    }
+
+    media_player_governor_set_core_budget(0);
+    g_free(p_uri);
+    (void)unlink(GOVERNOR_TEST_MEDIA_PATH);
+}
+
+/**
+ * \brief  Test probing generated media without a player
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void unit_test_probe()
+{
+    MpMediaInfo info;
+
+    CU_ASSERT_FATAL(test_generate_media(PROBE_MEDIA_PATH, PROBE_MEDIA_FRAMES));
+
+    CU_ASSERT(media_player_probe(PROBE_MEDIA_PATH, &info));
+    CU_ASSERT(1 == info.n_tracks);
+    CU_ASSERT(eMP_TRACK_VIDEO == info.tracks[0].type);
+    CU_ASSERT_STRING_EQUAL(info.tracks[0].codec, "image/jpeg");
+    CU_ASSERT(1920 == info.tracks[0].width);
+    CU_ASSERT(1080 == info.tracks[0].height);
+    CU_ASSERT((60 == info.tracks[0].framerate_num) && (1 == info.tracks[0].framerate_den));
+    CU_ASSERT(ABS(info.duration_ns - (gint64)((PROBE_MEDIA_FRAMES * GST_SECOND) / 60)) <= (gint64)(GST_SECOND / 60));
+
+    /* Text isn't media */
+    CU_ASSERT(g_file_set_contents(PROBE_MEDIA_PATH, "not media", -1, NULL));
+    CU_ASSERT_FALSE(media_player_probe(PROBE_MEDIA_PATH, &info));
+
+    (void)unlink(PROBE_MEDIA_PATH);
+}
+
+/**
+ * \brief  Benchmark cost of polling position/duration/state on playing players
+ * \details Polls SNAPSHOT_BENCH_PLAYERS playing players back to back for
+ *          SNAPSHOT_BENCH_TICKS ticks, while their sink probes keep writing
+ *          the snapshots, then does the same with position/duration/state
+ *          queries on as many playing playbin pipelines as a baseline.
+ *          Pipeline query cost is extrapolated to SNAPSHOT_BENCH_SNAPSHOTS players.
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void bench_snapshot_query_cost()
+{
+    MediaPlayer *p_players[SNAPSHOT_BENCH_PLAYERS]   = {NULL};
+    GstElement  *p_pipelines[SNAPSHOT_BENCH_PLAYERS] = {NULL};
+    gchar       *p_uri          = NULL;
+    gchar       *p_launch       = NULL;
+    int64_t      position       = 0;
+    int64_t      start_position = 0;
+    int64_t      duration       = 0;
+    GstState     state          = GST_STATE_NULL;
+    gint64       start_time     = 0;
+    gint64       snapshot_time  = 0;
+    gint64       query_time     = 0;
+    guint        queries        = 0;
+    int          tick           = 0;
+    int          i              = 0;
+
+    CU_ASSERT_FATAL(test_generate_media(SNAPSHOT_BENCH_MEDIA_PATH, TEST_MEDIA_FRAMES));
+    p_uri    = gst_filename_to_uri(SNAPSHOT_BENCH_MEDIA_PATH, NULL);
+    p_launch = g_strdup_printf("playbin uri=%s video-sink=fakesink audio-sink=fakesink", p_uri);
+
+    /* Measure polling, not the governor, so every player keeps playing */
+    media_player_governor_set_core_budget(SNAPSHOT_BENCH_PLAYERS * 2);
+
+    for (i = 0; i < SNAPSHOT_BENCH_PLAYERS; i++)
+    {
+        CU_ASSERT_PTR_NOT_NULL_FATAL(p_players[i] = media_player_new(NULL));
+        media_player_set_uri(p_players[i], p_uri);
+        CU_ASSERT(media_player_play(p_players[i]));
+
+        CU_ASSERT_PTR_NOT_NULL_FATAL(p_pipelines[i] = gst_parse_launch(p_launch, NULL));
+        (void)gst_element_set_state(p_pipelines[i], GST_STATE_PLAYING);
+    }
+
+    /* Let everything preroll and start writing positions */
+    sleep(1);
+    (void)media_player_get_position(p_players[0], &start_position);
+
+    start_time = g_get_monotonic_time();
+    for (tick = 0; tick < SNAPSHOT_BENCH_TICKS; tick++)
+    {
+        for (i = 0; i < SNAPSHOT_BENCH_PLAYERS; i++)
+        {
+            (void)media_player_get_position(p_players[i], &position);
+            (void)media_player_get_duration(p_players[i], &duration);
+            (void)media_player_get_state(p_players[i]);
+            queries += 3;
+        }
+    }
+    snapshot_time = MAX(g_get_monotonic_time() - start_time, 1);
+
+    start_time = g_get_monotonic_time();
+    for (tick = 0; tick < SNAPSHOT_BENCH_TICKS; tick++)
+    {
+        for (i = 0; i < SNAPSHOT_BENCH_PLAYERS; i++)
+        {
+            (void)gst_element_query_position(p_pipelines[i], GST_FORMAT_TIME, &position);
+            (void)gst_element_query_duration(p_pipelines[i], GST_FORMAT_TIME, &duration);
+            (void)gst_element_get_state(p_pipelines[i], &state, NULL, 0);
+        }
+    }
+    query_time = MAX(g_get_monotonic_time() - start_time, 1);
+
+    /* Snapshots must have been live, not a player sitting in NULL */
+    CU_ASSERT(eMP_STATE_PLAYING == media_player_get_state(p_players[0]));
+    CU_ASSERT(media_player_get_position(p_players[0], &position));
+    CU_ASSERT(position > start_position);
+
+    /* Running SNAPSHOT_BENCH_SNAPSHOTS real pipelines isn't practical, so pipeline
+       queries are extrapolated from their per query cost. Snapshots are measured
+       at that scale by bench_snapshot_poll_scale */
+    printf("\n%d playing players, %u queries: snapshot %.1fns/query, pipeline query %.1fns/query (%.1fx), "
+           "pipeline queries for %d players would cost %.1f%% of a %dHz frame per tick\n",
+           SNAPSHOT_BENCH_PLAYERS, queries, (snapshot_time * 1000.0) / queries, (query_time * 1000.0) / queries,
+           (gdouble)query_time / snapshot_time, SNAPSHOT_BENCH_SNAPSHOTS,
+           ((gdouble)query_time / queries) * 3 * SNAPSHOT_BENCH_SNAPSHOTS * 100.0 * SNAPSHOT_BENCH_POLL_HZ / G_USEC_PER_SEC,
+           SNAPSHOT_BENCH_POLL_HZ);
+
+    CU_ASSERT(snapshot_time < query_time);
+
+    for (i = 0; i < SNAPSHOT_BENCH_PLAYERS; i++)
+    {
+        media_player_destroy(p_players[i]);
+        (void)gst_element_set_state(p_pipelines[i], GST_STATE_NULL);
+        gst_object_unref(p_pipelines[i]);
+    }
+
+    media_player_governor_set_core_budget(0);
+    g_free(p_launch);
+    g_free(p_uri);
+    (void)unlink(SNAPSHOT_BENCH_MEDIA_PATH);
+}
+
+/**
+ * \brief  Writer thread for bench_snapshot_poll_scale, standing in for sink probes
+ * \details Advances every snapshot's position as fast as it can until told to
+ *          stop, so readers are always racing a writer.
+ * 
+ * \param[in] p_data - SnapshotBenchWriter
+ * 
+ * \return gpointer - NULL
+ * \author Jason Neitzert
+ */
+static gpointer bench_snapshot_writer(gpointer p_data)
+{
+    SnapshotBenchWriter *p_writer = (SnapshotBenchWriter*)p_data;
+    GstClockTime         position = 0;
+    int                  i        = 0;
+
+    while (!g_atomic_int_get(&p_writer->stop))
+    {
+        position += GST_MSECOND;
+
+        for (i = 0; i < SNAPSHOT_BENCH_SNAPSHOTS; i++)
+        {
+            media_player_snapshot_set_position(&p_writer->p_snapshots[i], position);
+        }
+
+        p_writer->passes++;
+    }
+
+    return NULL;
+}
+
+/**
+ * \brief  Benchmark polling SNAPSHOT_BENCH_SNAPSHOTS snapshots at SNAPSHOT_BENCH_POLL_HZ
+ * \details Snapshots are those the plugin publishes, written continuously by a
+ *          writer thread in place of that many sink probes. Each tick is paced
+ *          to the poll rate and reads position/duration/state of every snapshot,
+ *          which must fit well inside one frame.
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void bench_snapshot_poll_scale()
+{
+    MediaPlayerSnapshot *p_snapshots  = g_new(MediaPlayerSnapshot, SNAPSHOT_BENCH_SNAPSHOTS);
+    SnapshotBenchWriter  writer       = {p_snapshots, 0, 0};
+    GThread             *p_thread     = NULL;
+    GstClockTime         position     = GST_CLOCK_TIME_NONE;
+    GstClockTime         duration     = GST_CLOCK_TIME_NONE;
+    GstClockTime         last         = 0;
+    GstState             state        = GST_STATE_NULL;
+    gint64               frame_time   = G_USEC_PER_SEC / SNAPSHOT_BENCH_POLL_HZ;
+    gint64               start_time   = 0;
+    gint64               tick_start   = 0;
+    gint64               tick_time    = 0;
+    gint64               total_time   = 0;
+    gint64               max_time     = 0;
+    gint64               now          = 0;
+    guint                stale        = 0;
+    int                  tick         = 0;
+    int                  i            = 0;
+
+    for (i = 0; i < SNAPSHOT_BENCH_SNAPSHOTS; i++)
+    {
+        media_player_snapshot_init(&p_snapshots[i]);
+        media_player_snapshot_set_duration(&p_snapshots[i], 60 * GST_SECOND);
+        media_player_snapshot_set_state(&p_snapshots[i], GST_STATE_PLAYING);
+    }
+
+    p_thread = g_thread_new("snapshot-writer", bench_snapshot_writer, &writer);
+
+    start_time = g_get_monotonic_time();
+    for (tick = 0; tick < SNAPSHOT_BENCH_TICKS; tick++)
+    {
+        /* Wait for this tick's frame like a UI would */
+        now = g_get_monotonic_time();
+        if (now < (start_time + (tick * frame_time)))
+        {
+            g_usleep((start_time + (tick * frame_time)) - now);
+        }
+
+        tick_start = g_get_monotonic_time();
+        for (i = 0; i < SNAPSHOT_BENCH_SNAPSHOTS; i++)
+        {
+            media_player_snapshot_read(&p_snapshots[i], &position, &duration, &state);
+        }
+        tick_time = g_get_monotonic_time() - tick_start;
+
+        /* Every snapshot is written each writer pass, so the last one read must have moved on */
+        if (position <= last)
+        {
+            stale++;
+        }
+        last = position;
+
+        total_time += tick_time;
+        max_time    = MAX(max_time, tick_time);
+    }
+
+    g_atomic_int_set(&writer.stop, TRUE);
+    (void)g_thread_join(p_thread);
+
+    printf("\n%d snapshots polled at %dHz for %d ticks against %" G_GUINT64_FORMAT " writer passes: "
+           "%.1fus/tick average, %" G_GINT64_FORMAT "us worst, %.3f%% of a frame on average\n",
+           SNAPSHOT_BENCH_SNAPSHOTS, SNAPSHOT_BENCH_POLL_HZ, SNAPSHOT_BENCH_TICKS, writer.passes,
+           (gdouble)total_time / SNAPSHOT_BENCH_TICKS, max_time,
+           (total_time * 100.0) / (SNAPSHOT_BENCH_TICKS * (gdouble)frame_time));
+
+    CU_ASSERT((60 * GST_SECOND) == duration);
+    CU_ASSERT(GST_STATE_PLAYING == state);
+    CU_ASSERT(stale < (SNAPSHOT_BENCH_TICKS / 10));
+    CU_ASSERT(max_time < frame_time);
+
+    for (i = 0; i < SNAPSHOT_BENCH_SNAPSHOTS; i++)
+    {
+        media_player_snapshot_clear(&p_snapshots[i]);
+    }
+    g_free(p_snapshots);
+}
+
+/**
+ * \brief  Test analytics raises black, scene change and frozen events
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void unit_test_analytics_events()
+{
+    MediaPlayerAnalytics      analytics;
+    MediaPlayerFrameStats     stats;
+    MediaPlayerAnalyticsEvent events  = eMPA_EVENT_NONE;
+    guint                     frozen  = 0;
+    guint8                   *p_black = g_malloc(ANALYTICS_BENCH_WIDTH * ANALYTICS_BENCH_HEIGHT);
+    guint8                   *p_noise = g_malloc(ANALYTICS_BENCH_WIDTH * ANALYTICS_BENCH_HEIGHT);
+    int                       i       = 0;
+
+    memset(p_black, 16, ANALYTICS_BENCH_WIDTH * ANALYTICS_BENCH_HEIGHT);
+    for (i = 0; i < (ANALYTICS_BENCH_WIDTH * ANALYTICS_BENCH_HEIGHT); i++)
+    {
+        p_noise[i] = (guint8)g_random_int();
+    }
+
+    media_player_analytics_init(&analytics);
+
+    events = media_player_analytics_process(&analytics, p_black, ANALYTICS_BENCH_WIDTH,
+                                            ANALYTICS_BENCH_WIDTH, ANALYTICS_BENCH_HEIGHT, &stats);
+    CU_ASSERT(events == eMPA_EVENT_BLACK_FRAME);
+    CU_ASSERT(stats.difference < 0.0);
+    CU_ASSERT_DOUBLE_EQUAL(stats.mean, 16.0, 0.001);
+
+    events = media_player_analytics_process(&analytics, p_noise, ANALYTICS_BENCH_WIDTH,
+                                            ANALYTICS_BENCH_WIDTH, ANALYTICS_BENCH_HEIGHT, &stats);
+    CU_ASSERT(events == eMPA_EVENT_SCENE_CHANGE);
+    CU_ASSERT(stats.variance > 1000.0);
+
+    /* Same frame over and over reports frozen exactly once */
+    for (i = 0; i < 60; i++)
+    {
+        if (media_player_analytics_process(&analytics, p_noise, ANALYTICS_BENCH_WIDTH,
+                                           ANALYTICS_BENCH_WIDTH, ANALYTICS_BENCH_HEIGHT, &stats) & eMPA_EVENT_FROZEN_FRAME)
+        {
+            frozen++;
+        }
+    }
+    CU_ASSERT(frozen == 1);
+    CU_ASSERT_DOUBLE_EQUAL(stats.difference, 0.0, 0.001);
+
+    media_player_analytics_clear(&analytics);
+    g_free(p_black);
+    g_free(p_noise);
+}
+
+/**
+ * \brief  Micro benchmark analytics kernels against the scalar versions
+ * \details Every available kernel set must match scalar results exactly.
+ *          The histogram has no SIMD versions, so it is timed once on its own.
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void bench_analytics_kernels()
+{
+    const MediaPlayerAnalyticsKernels *p_kernel_sets[] = {media_player_analytics_kernels_scalar(),
+                                                          media_player_analytics_kernels_sse4(),
+                                                          media_player_analytics_kernels_avx2()};
+    guint32  histogram[MEDIA_PLAYER_ANALYTICS_HISTOGRAM_BINS] = {0};
+    guint8  *p_current   = g_malloc(ANALYTICS_BENCH_WIDTH * ANALYTICS_BENCH_HEIGHT);
+    guint8  *p_previous  = g_malloc(ANALYTICS_BENCH_WIDTH * ANALYTICS_BENCH_HEIGHT);
+    guint64  scalar_sad  = 0;
+    guint64  sad         = 0;
+    guint64  total       = 0;
+    gint64   start_time  = 0;
+    gint64   sad_time    = 0;
+    gint64   hist_time   = 0;
+    guint    set         = 0;
+    int      i           = 0;
+
+    for (i = 0; i < (ANALYTICS_BENCH_WIDTH * ANALYTICS_BENCH_HEIGHT); i++)
+    {
+        p_current[i]  = (guint8)g_random_int();
+        p_previous[i] = (guint8)g_random_int();
+    }
+
+    scalar_sad = p_kernel_sets[0]->luma_sad(p_current, ANALYTICS_BENCH_WIDTH, p_previous, ANALYTICS_BENCH_WIDTH,
+                                            ANALYTICS_BENCH_WIDTH, ANALYTICS_BENCH_HEIGHT);
+
+    start_time = g_get_monotonic_time();
+    for (i = 0; i < ANALYTICS_BENCH_ITERATIONS; i++)
+    {
+        memset(histogram, 0, sizeof(histogram));
+        media_player_analytics_luma_histogram(p_current, ANALYTICS_BENCH_WIDTH, ANALYTICS_BENCH_WIDTH,
+                                              ANALYTICS_BENCH_HEIGHT, histogram);
+    }
+    hist_time = g_get_monotonic_time() - start_time;
+
+    for (i = 0; i < MEDIA_PLAYER_ANALYTICS_HISTOGRAM_BINS; i++)
+    {
+        total += histogram[i];
+    }
+    CU_ASSERT(total == (ANALYTICS_BENCH_WIDTH * ANALYTICS_BENCH_HEIGHT));
+
+    printf("\nAnalytics histogram (scalar, used by every kernel set) 1080p %7.1fus/frame\n",
+           (gdouble)hist_time / ANALYTICS_BENCH_ITERATIONS);
+
+    for (set = 0; set < G_N_ELEMENTS(p_kernel_sets); set++)
+    {
+        if (!p_kernel_sets[set])
+        {
+            printf("Analytics kernels %u: not supported by cpu\n", set);
+        }
+        else
+        {
+            start_time = g_get_monotonic_time();
+            for (i = 0; i < ANALYTICS_BENCH_ITERATIONS; i++)
+            {
+                sad = p_kernel_sets[set]->luma_sad(p_current, ANALYTICS_BENCH_WIDTH, p_previous, ANALYTICS_BENCH_WIDTH,
+                                                   ANALYTICS_BENCH_WIDTH, ANALYTICS_BENCH_HEIGHT);
+            }
+            sad_time = g_get_monotonic_time() - start_time;
+
+            CU_ASSERT(sad == scalar_sad);
+
+            printf("Analytics kernels %-7s 1080p sad %7.1fus/frame\n",
+                   p_kernel_sets[set]->p_name, (gdouble)sad_time / ANALYTICS_BENCH_ITERATIONS);
+        }
+    }
+
+    g_free(p_current);
+    g_free(p_previous);
+}
+
+/**
+ * \brief  Body of a shared memory consumer process
+ * \details In SHM_CONSUMER_HOLD mode acquires frames without ever releasing
+ *          them until the producer can't publish any more, prints a
+ *          SHM_CONSUMER_HELD line and waits to be killed. In
+ *          SHM_CONSUMER_BENCH mode reads frames until the producer stops and
+ *          prints a SHM_CONSUMER_RESULT line. Only uses the consumer library.
+ * 
+ * \param[in] p_mode        - SHM_CONSUMER_HOLD or SHM_CONSUMER_BENCH
+ * \param[in] p_socket_path - socket of the player to attach to
+ * 
+ * \return int - process exit code
+ * \author Jason Neitzert
+ */
+static int shm_consumer_child(const gchar *p_mode, const gchar *p_socket_path)
+{
+    ShmBenchResult  result     = {0};
+    MpShmConsumer  *p_consumer = media_player_shm_attach(p_socket_path);
+    MpShmFrame      frame;
+    struct timespec now;
+    gint64          latency    = 0;
+    volatile guint8 sample     = 0;
+    guint           held       = 0;
+    int             retval     = 0;
+
+    if (!p_consumer)
+    {
+        retval = 1;
+    }
+    else if (!strcmp(p_mode, SHM_CONSUMER_HOLD))
+    {
+        /* Acquiring a newer frame never releases the older ones, so this ends once every slot is ours */
+        while (media_player_shm_acquire_next(p_consumer, 1000, &frame))
+        {
+            held++;
+        }
+
+        printf(SHM_CONSUMER_HELD " %u\n", held);
+        fflush(stdout);
+
+        while (true)
+        {
+            pause();
+        }
+    }
+    else
+    {
+        while (media_player_shm_acquire_next(p_consumer, 1000, &frame))
+        {
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            latency = (((gint64)now.tv_sec * G_GINT64_CONSTANT(1000000000)) + now.tv_nsec) - frame.publish_time;
+
+            /* Touch the frame so it is really read from shared memory */
+            sample = frame.p_data[frame.size / 2];
+            media_player_shm_release(p_consumer, &frame);
+
+            result.frames++;
+            result.total_latency += latency;
+            result.max_latency    = MAX(result.max_latency, latency);
+        }
+
+        media_player_shm_detach(p_consumer);
+
+        printf(SHM_CONSUMER_RESULT " %" G_GUINT64_FORMAT " %" G_GINT64_FORMAT " %" G_GINT64_FORMAT "\n",
+               result.frames, result.total_latency, result.max_latency);
+    }
+
+    (void)sample;
+
+    return retval;
+}
+
+/**
+ * \brief  Start a shared memory consumer in a new test_app process
+ * 
+ * \param[in]  p_mode        - SHM_CONSUMER_HOLD or SHM_CONSUMER_BENCH
+ * \param[in]  p_socket_path - socket of the player to attach to
+ * \param[out] p_pid         - pid of the process
+ * 
+ * \return FILE* - stdout of the process, NULL if it couldn't be started
+ * \author Jason Neitzert
+ */
+static FILE *shm_consumer_spawn(const gchar *p_mode, const gchar *p_socket_path, GPid *p_pid)
+{
+    gchar  *p_argv[]  = {"/proc/self/exe", SHM_CONSUMER_CHILD_ARG, (gchar*)p_mode, (gchar*)p_socket_path, NULL};
+    GError *p_error   = NULL;
+    FILE   *p_output  = NULL;
+    gint    stdout_fd = -1;
+
+    if (!g_spawn_async_with_pipes(NULL, p_argv, NULL, G_SPAWN_DO_NOT_REAP_CHILD, NULL, NULL, p_pid,
+                                  NULL, &stdout_fd, NULL, &p_error))
+    {
+        printf("\nFailed to start shared memory consumer: %s\n", p_error->message);
+        g_error_free(p_error);
+    }
+    else
+    {
+        p_output = fdopen(stdout_fd, "r");
+    }
+
+    return p_output;
+}
+
+/**
+ * \brief  Wait for a shared memory consumer process to print a tagged line
+ * 
+ * \param[in]  p_output - stdout of the process
+ * \param[in]  p_tag    - tag the line starts with
+ * \param[out] p_line   - buffer for the line
+ * \param[in]  size     - size of p_line
+ * 
+ * \return const gchar* - values following the tag, NULL if the process exited without printing it
+ * \author Jason Neitzert
+ */
+static const gchar *shm_consumer_wait_line(FILE *p_output, const gchar *p_tag, gchar *p_line, gsize size)
+{
+    const gchar *p_values = NULL;
+
+    while (!p_values && fgets(p_line, size, p_output))
+    {
+        if (g_str_has_prefix(p_line, p_tag))
+        {
+            p_values = p_line + strlen(p_tag);
+        }
+    }
+
+    return p_values;
+}
+
+/**
+ * \brief  Create a player exporting frames to shared memory and start it playing
+ * 
+ * \param[in] p_path        - media file to play
+ * \param[in] p_socket_path - socket to export on
+ * \param[in] slots         - slots in the ring
+ * 
+ * \return MediaPlayer* - the playing player, NULL on failure
+ * \author Jason Neitzert
+ */
+static MediaPlayer *shm_test_create_player(const gchar *p_path, const gchar *p_socket_path, guint slots)
+{
+    MediaPlayer *p_media_player = media_player_new(NULL);
+    gchar       *p_uri          = gst_filename_to_uri(p_path, NULL);
+
+    if (p_media_player)
+    {
+        media_player_set_uri(p_media_player, p_uri);
+        media_player_set_shm_export(p_media_player, p_socket_path, slots);
+
+        if (!media_player_play(p_media_player))
+        {
+            media_player_destroy(p_media_player);
+            p_media_player = NULL;
+        }
+    }
+
+    g_free(p_uri);
+
+    return p_media_player;
+}
+
+/**
+ * \brief  Test frames exported by a playing player arrive intact
+ * \details Checks size, format, layout and pixel content of frames against
+ *          the white source, and that they were decoded straight into the
+ *          ring rather than copied.
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void unit_test_shm_export()
+{
+    MediaPlayer              *p_media_player = NULL;
+    MpShmConsumer            *p_consumer     = NULL;
+    const GstVideoFormatInfo *p_format_info  = NULL;
+    const uint8_t            *p_pixel        = NULL;
+    MpShmExportStats          stats;
+    MpShmFrame                frame;
+    GstVideoInfo              info;
+    GstVideoFormat            format         = GST_VIDEO_FORMAT_UNKNOWN;
+    uint64_t                  last_sequence  = 0;
+    guint                     frames         = 0;
+    guint                     plane          = 0;
+
+    CU_ASSERT_FATAL(test_generate_shm_media());
+    CU_ASSERT_PTR_NOT_NULL_FATAL(p_media_player = shm_test_create_player(SHM_TEST_MEDIA_PATH, SHM_TEST_SOCKET_PATH,
+                                                                          SHM_TEST_SLOTS));
+
+    /* Blocks until the player has negotiated caps */
+    p_consumer = media_player_shm_attach(SHM_TEST_SOCKET_PATH);
+    CU_ASSERT_PTR_NOT_NULL(p_consumer);
+
+    while (p_consumer && (frames < SHM_TEST_FRAMES) &&
+           media_player_shm_acquire_next(p_consumer, SHM_TEST_TIMEOUT_MS, &frame))
+    {
+        format = gst_video_format_from_string(frame.format);
+
+        CU_ASSERT(frame.sequence > last_sequence);
+        CU_ASSERT(SHM_TEST_WIDTH == frame.width);
+        CU_ASSERT(SHM_TEST_HEIGHT == frame.height);
+        CU_ASSERT(GST_VIDEO_FORMAT_UNKNOWN != format);
+
+        if ((GST_VIDEO_FORMAT_UNKNOWN != format) && gst_video_info_set_format(&info, format, frame.width, frame.height))
+        {
+            /* Decoders may pad rows and planes, but never pack them tighter than the format */
+            CU_ASSERT(GST_VIDEO_INFO_SIZE(&info) <= frame.size);
+            CU_ASSERT(GST_VIDEO_INFO_N_PLANES(&info) == frame.n_planes);
+
+            for (plane = 0; plane < MIN(frame.n_planes, MP_SHM_FRAME_MAX_PLANES); plane++)
+            {
+                CU_ASSERT(GST_VIDEO_INFO_PLANE_STRIDE(&info, plane) <= (gint)frame.strides[plane]);
+                CU_ASSERT((frame.offsets[plane] + (frame.strides[plane] *
+                           GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT(info.finfo, plane, frame.height))) <= frame.size);
+            }
+
+            /* Luma or red of white is near full scale whatever format the sink chose */
+            p_format_info = info.finfo;
+            p_pixel       = frame.p_data + frame.offsets[GST_VIDEO_FORMAT_INFO_PLANE(p_format_info, 0)] +
+                            ((frame.height / 2) * frame.strides[GST_VIDEO_FORMAT_INFO_PLANE(p_format_info, 0)]) +
+                            ((frame.width / 2) * GST_VIDEO_FORMAT_INFO_PSTRIDE(p_format_info, 0)) +
+                            GST_VIDEO_FORMAT_INFO_POFFSET(p_format_info, 0);
+            CU_ASSERT(*p_pixel > 200);
+        }
+
+        last_sequence = frame.sequence;
+        media_player_shm_release(p_consumer, &frame);
+        frames++;
+    }
+
+    CU_ASSERT(SHM_TEST_FRAMES == frames);
+
+    media_player_get_shm_export_stats(p_media_player, &stats);
+    CU_ASSERT(stats.published >= frames);
+    CU_ASSERT(0 == stats.copied);
+
+    if (p_consumer)
+    {
+        media_player_shm_detach(p_consumer);
+    }
+
+    media_player_destroy(p_media_player);
+    (void)unlink(SHM_TEST_MEDIA_PATH);
+}
+
+/**
+ * \brief  Test exporting to a path that isn't a socket leaves the file alone
+ * \details Export fails and nothing is published, but the player still plays.
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void unit_test_shm_socket_path()
+{
+    MediaPlayer      *p_media_player = NULL;
+    gchar            *p_contents     = NULL;
+    MpShmExportStats  stats;
+
+    CU_ASSERT_FATAL(test_generate_shm_media());
+    CU_ASSERT_FATAL(g_file_set_contents(SHM_TEST_SOCKET_PATH, SHM_TEST_NOT_SOCKET, -1, NULL));
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(p_media_player = shm_test_create_player(SHM_TEST_MEDIA_PATH, SHM_TEST_SOCKET_PATH,
+                                                                          SHM_TEST_SLOTS));
+    sleep(1);
+
+    media_player_get_shm_export_stats(p_media_player, &stats);
+    CU_ASSERT(0 == stats.published);
+    CU_ASSERT(eMP_STATE_PLAYING == media_player_get_state(p_media_player));
+
+    media_player_destroy(p_media_player);
+
+    CU_ASSERT(g_file_get_contents(SHM_TEST_SOCKET_PATH, &p_contents, NULL, NULL));
+    CU_ASSERT_STRING_EQUAL(p_contents ? p_contents : "", SHM_TEST_NOT_SOCKET);
+
+    g_free(p_contents);
+    (void)unlink(SHM_TEST_SOCKET_PATH);
+    (void)unlink(SHM_TEST_MEDIA_PATH);
+}
+
+/**
+ * \brief  Test a consumer dying while holding frames doesn't stall the player
+ * \details A consumer process acquires frames until it holds every slot and
+ *          publishing stops, then is killed. Its frames must be given back
+ *          so publishing resumes for the next consumer.
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void unit_test_shm_consumer_crash()
+{
+    MediaPlayer      *p_media_player = NULL;
+    MpShmConsumer    *p_consumer     = NULL;
+    FILE             *p_output       = NULL;
+    const gchar      *p_values       = NULL;
+    MpShmExportStats  held_stats;
+    MpShmExportStats  stalled_stats;
+    MpShmExportStats  stats;
+    MpShmFrame        frame;
+    gchar             line[256];
+    GPid              pid            = 0;
+    uint64_t          last_sequence  = 0;
+    guint             held           = 0;
+    guint             frames         = 0;
+
+    CU_ASSERT_FATAL(test_generate_shm_media());
+    CU_ASSERT_PTR_NOT_NULL_FATAL(p_media_player = shm_test_create_player(SHM_TEST_MEDIA_PATH, SHM_TEST_SOCKET_PATH,
+                                                                          SHM_TEST_CRASH_SLOTS));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(p_output = shm_consumer_spawn(SHM_CONSUMER_HOLD, SHM_TEST_SOCKET_PATH, &pid));
+
+    if ((p_values = shm_consumer_wait_line(p_output, SHM_CONSUMER_HELD, line, sizeof(line))))
+    {
+        held = (guint)g_ascii_strtoull(p_values, NULL, 10);
+    }
+    CU_ASSERT(held > 0);
+
+    /* Every slot is leased, so frames are dropped rather than published */
+    media_player_get_shm_export_stats(p_media_player, &held_stats);
+    sleep(1);
+    media_player_get_shm_export_stats(p_media_player, &stalled_stats);
+    CU_ASSERT(stalled_stats.published == held_stats.published);
+    CU_ASSERT(stalled_stats.dropped > held_stats.dropped);
+
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    g_spawn_close_pid(pid);
+    fclose(p_output);
+
+    p_consumer = media_player_shm_attach(SHM_TEST_SOCKET_PATH);
+    CU_ASSERT_PTR_NOT_NULL(p_consumer);
+
+    while (p_consumer && (frames < SHM_TEST_FRAMES) &&
+           media_player_shm_acquire_next(p_consumer, SHM_TEST_TIMEOUT_MS, &frame))
+    {
+        CU_ASSERT(frame.sequence > last_sequence);
+        last_sequence = frame.sequence;
+        media_player_shm_release(p_consumer, &frame);
+        frames++;
+    }
+
+    CU_ASSERT(SHM_TEST_FRAMES == frames);
+
+    media_player_get_shm_export_stats(p_media_player, &stats);
+    CU_ASSERT(stats.published >= (stalled_stats.published + frames));
+
+    if (p_consumer)
+    {
+        media_player_shm_detach(p_consumer);
+    }
+
+    media_player_destroy(p_media_player);
+    (void)unlink(SHM_TEST_MEDIA_PATH);
+}
+
+/**
+ * \brief  Benchmark shared memory frame export of a playing player
+ * \details Plays 1080p60 media for SHM_BENCH_SECONDS with SHM_BENCH_CONSUMERS
+ *          consumer processes attached, and reports how many frames had to
+ *          be copied into the ring and the latency consumers saw.
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void bench_shm_export()
+{
+    MediaPlayer      *p_media_player = NULL;
+    FILE             *p_outputs[SHM_BENCH_CONSUMERS] = {NULL};
+    GPid              pids[SHM_BENCH_CONSUMERS];
+    const gchar      *p_values       = NULL;
+    ShmBenchResult    result;
+    MpShmExportStats  stats;
+    gchar             line[256];
+    gint64            start_time     = 0;
+    gint64            run_time       = 0;
+    int               i              = 0;
+
+    CU_ASSERT_FATAL(test_generate_media(SHM_BENCH_MEDIA_PATH, TEST_MEDIA_FRAMES));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(p_media_player = shm_test_create_player(SHM_BENCH_MEDIA_PATH, SHM_BENCH_SOCKET_PATH,
+                                                                          SHM_BENCH_SLOTS));
+
+    start_time = g_get_monotonic_time();
+
+    for (i = 0; i < SHM_BENCH_CONSUMERS; i++)
+    {
+        CU_ASSERT_PTR_NOT_NULL(p_outputs[i] = shm_consumer_spawn(SHM_CONSUMER_BENCH, SHM_BENCH_SOCKET_PATH, &pids[i]));
+    }
+
+    sleep(SHM_BENCH_SECONDS);
+
+    run_time = g_get_monotonic_time() - start_time;
+    media_player_get_shm_export_stats(p_media_player, &stats);
+
+    printf("\nShared memory export: %" G_GUINT64_FORMAT " 1080p frames published, %.1f frames/s, %" G_GUINT64_FORMAT
+           " copied into the ring, %" G_GUINT64_FORMAT " dropped (all slots held)\n",
+           stats.published, (stats.published * (gdouble)G_USEC_PER_SEC) / run_time, stats.copied, stats.dropped);
+
+    CU_ASSERT(stats.published > 0);
+
+    /* Closes the ring, which lets the consumers finish */
+    media_player_destroy(p_media_player);
+
+    for (i = 0; i < SHM_BENCH_CONSUMERS; i++)
+    {
+        if (p_outputs[i])
+        {
+            memset(&result, 0, sizeof(result));
+
+            if ((p_values = shm_consumer_wait_line(p_outputs[i], SHM_CONSUMER_RESULT, line, sizeof(line))))
+            {
+                (void)sscanf(p_values, " %" G_GUINT64_FORMAT " %" G_GINT64_FORMAT " %" G_GINT64_FORMAT,
+                             &result.frames, &result.total_latency, &result.max_latency);
+            }
+
+            fclose(p_outputs[i]);
+            waitpid(pids[i], NULL, 0);
+            g_spawn_close_pid(pids[i]);
+
+            CU_ASSERT(result.frames > 0);
+            printf("Consumer %d: %.1f frames/s, latency avg %.1fus max %.1fus\n", i,
+                   (result.frames * (gdouble)G_USEC_PER_SEC) / run_time,
+                   result.frames ? (result.total_latency / 1000.0) / result.frames : 0.0,
+                   result.max_latency / 1000.0);
+        }
+    }
+
+    (void)unlink(SHM_BENCH_MEDIA_PATH);
+}
+
+/**
+ * \brief  Sysmem alloc wrapper counting allocations for the frame arena bench
+ * 
+ * \param[in] p_allocator - sysmem allocator
+ * \param[in] size        - size wanted
+ * \param[in] p_params    - allocation params
+ * 
+ * \return GstMemory* - memory from the real sysmem alloc
+ * \author Jason Neitzert
+ */
+static GstMemory *arena_bench_counting_alloc(GstAllocator *p_allocator, gsize size, GstAllocationParams *p_params)
+{
+    __atomic_add_fetch(&sysmem_allocs, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&sysmem_alloc_bytes, size, __ATOMIC_RELAXED);
+
+    return p_sysmem_alloc(p_allocator, size, p_params);
+}
+
+/**
+ * \brief  Read a kB value such as VmRSS from /proc/self/status
+ * 
+ * \param[in] p_name - name of value including the colon
+ * 
+ * \return guint64 - value in kB, 0 if not found
+ * \author Jason Neitzert
+ */
+static guint64 arena_bench_read_status(const gchar *p_name)
+{
+    gchar   *p_status = NULL;
+    gchar   *p_line   = NULL;
+    guint64  value    = 0;
+
+    if (g_file_get_contents("/proc/self/status", &p_status, NULL, NULL))
+    {
+        if ((p_line = strstr(p_status, p_name)))
+        {
+            value = g_ascii_strtoull(p_line + strlen(p_name), NULL, 10);
+        }
+
+        g_free(p_status);
+    }
+
+    return value;
+}
+
+/**
+ * \brief  Body of a frame arena bench process
+ * \details Runs ARENA_BENCH_ROUNDS rounds of creating, playing and destroying
+ *          the players, so reuse of memory between rounds shows up, then
+ *          prints an ARENA_BENCH_RESULT line for the parent to parse.
+ * 
+ * \param[in] players     - number of players to run at once
+ * \param[in] frame_arena - arena the players use
+ * \param[in] p_uri       - media to play
+ * 
+ * \return int - process exit code
+ * \author Jason Neitzert
+ */
+static int arena_bench_child(guint players, MpFrameArena frame_arena, const gchar *p_uri)
+{
+    MediaPlayer       *p_players[ARENA_BENCH_MAX_PLAYERS] = {NULL};
+    GstAllocator      *p_sysmem     = NULL;
+    GstAllocator      *p_arena      = NULL;
+    GstAllocatorClass *p_class      = NULL;
+    struct rusage      usage_start;
+    struct rusage      usage_end;
+    gint64             start_time   = 0;
+    guint64            arena_allocs = 0;
+    guint              round       = 0;
+    guint              i           = 0;
+    int                retval      = 0;
+
+    media_player_api_init();
+
+    p_sysmem       = gst_allocator_find(GST_ALLOCATOR_SYSMEM);
+    p_class        = GST_ALLOCATOR_GET_CLASS(p_sysmem);
+    p_sysmem_alloc = p_class->alloc;
+    p_class->alloc = arena_bench_counting_alloc;
+    gst_object_unref(p_sysmem);
+
+    /* Measure allocation, not the governor, so every player fits */
+    players = MIN(players, ARENA_BENCH_MAX_PLAYERS);
+    media_player_governor_set_core_budget(players);
+
+    getrusage(RUSAGE_SELF, &usage_start);
+    start_time = g_get_monotonic_time();
+
+    for (round = 0; round < ARENA_BENCH_ROUNDS; round++)
+    {
+        for (i = 0; i < players; i++)
+        {
+            if ((p_players[i] = media_player_new(NULL)))
+            {
+                media_player_set_uri(p_players[i], p_uri);
+                media_player_set_frame_arena(p_players[i], frame_arena);
+
+                if (!media_player_play(p_players[i]))
+                {
+                    retval = 1;
+                }
+            }
+            else
+            {
+                retval = 1;
+            }
+        }
+
+        sleep(ARENA_BENCH_SECONDS);
+
+        for (i = 0; i < players; i++)
+        {
+            if (p_players[i])
+            {
+                media_player_destroy(p_players[i]);
+                p_players[i] = NULL;
+            }
+        }
+    }
+
+    getrusage(RUSAGE_SELF, &usage_end);
+
+    /* Arenas aren't system memory, count what they handed out separately */
+    if ((eMP_FRAME_ARENA_OFF != frame_arena) &&
+        (p_arena = gst_allocator_find((eMP_FRAME_ARENA_HUGE_PAGES == frame_arena) ? 
+                                      MEDIA_PLAYER_ARENA_HUGE_PAGES_NAME : MEDIA_PLAYER_ARENA_NAME)))
+    {
+        g_object_get(p_arena, "allocations", &arena_allocs, NULL);
+        gst_object_unref(p_arena);
+    }
+
+    printf("\n" ARENA_BENCH_RESULT " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT
+           " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %f\n",
+           arena_bench_read_status("VmRSS:"), arena_bench_read_status("VmHWM:"),
+           (guint64)(usage_end.ru_minflt + usage_end.ru_majflt - usage_start.ru_minflt - usage_start.ru_majflt),
+           __atomic_load_n(&sysmem_allocs, __ATOMIC_RELAXED), __atomic_load_n(&sysmem_alloc_bytes, __ATOMIC_RELAXED),
+           arena_allocs, (g_get_monotonic_time() - start_time) / (gdouble)G_USEC_PER_SEC);
+
+    return retval;
+}
+
+/**
+ * \brief  Run one frame arena bench configuration in a new test_app process
+ * 
+ * \param[in]  players     - number of players to run at once
+ * \param[in]  frame_arena - arena the players use
+ * \param[in]  p_uri       - media to play
+ * \param[out] p_result    - what the process measured
+ * 
+ * \return bool - true if the process ran and reported
+ * \author Jason Neitzert
+ */
+static bool arena_bench_run(guint players, MpFrameArena frame_arena, const gchar *p_uri, ArenaBenchResult *p_result)
+{
+    gchar   *p_players_arg = g_strdup_printf("%u", players);
+    gchar   *p_arena_arg   = g_strdup_printf("%d", frame_arena);
+    gchar   *p_argv[]      = {"/proc/self/exe", ARENA_BENCH_CHILD_ARG, p_players_arg, p_arena_arg, (gchar*)p_uri, NULL};
+    gchar   *p_output      = NULL;
+    gchar   *p_line        = NULL;
+    GError  *p_error       = NULL;
+    gint     status        = 0;
+    bool     reported      = false;
+
+    if (!g_spawn_sync(NULL, p_argv, NULL, G_SPAWN_DEFAULT, NULL, NULL, &p_output, NULL, &status, &p_error))
+    {
+        printf("\nFailed to run frame arena bench: %s\n", p_error->message);
+        g_error_free(p_error);
+    }
+    else
+    {
+        if (g_spawn_check_exit_status(status, NULL) && (p_line = strstr(p_output, ARENA_BENCH_RESULT)))
+        {
+            reported = (7 == sscanf(p_line + strlen(ARENA_BENCH_RESULT),
+                                    " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT
+                                    " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %" G_GUINT64_FORMAT " %lf",
+                                    &p_result->rss_kb, &p_result->peak_rss_kb, &p_result->page_faults,
+                                    &p_result->allocs, &p_result->alloc_bytes, &p_result->arena_allocs,
+                                    &p_result->seconds));
+        }
+
+        g_free(p_output);
+    }
+
+    g_free(p_players_arg);
+    g_free(p_arena_arg);
+
+    return reported;
+}
+
+/**
+ * \brief  Benchmark frame arena against the sink's default pool
+ * \details Compares RSS, page faults, and system memory and arena allocation
+ *          rates with 1, 10 and 50 players of 1080p60 media generated by videotestsrc.
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void bench_frame_arena()
+{
+    static const guint        player_counts[] = {1, 10, ARENA_BENCH_MAX_PLAYERS};
+    static const MpFrameArena arenas[]        = {eMP_FRAME_ARENA_OFF, eMP_FRAME_ARENA_ON, eMP_FRAME_ARENA_HUGE_PAGES};
+    static const gchar       *p_arena_names[] = {"default", "arena", "huge pages"};
+    ArenaBenchResult          result;
+    gchar                    *p_uri           = NULL;
+    guint                     i               = 0;
+    guint                     j               = 0;
+
+    CU_ASSERT_FATAL(test_generate_media(ARENA_BENCH_MEDIA_PATH, TEST_MEDIA_FRAMES));
+    p_uri = gst_filename_to_uri(ARENA_BENCH_MEDIA_PATH, NULL);
+
+    printf("\nFrame arena, %d rounds of %ds per run:\n", ARENA_BENCH_ROUNDS, ARENA_BENCH_SECONDS);
+
+    for (i = 0; i < G_N_ELEMENTS(player_counts); i++)
+    {
+        for (j = 0; j < G_N_ELEMENTS(arenas); j++)
+        {
+            memset(&result, 0, sizeof(result));
+            CU_ASSERT(arena_bench_run(player_counts[i], arenas[j], p_uri, &result));
+
+            printf("%2u players %-10s: RSS %6.1fMB peak %6.1fMB, %8" G_GUINT64_FORMAT " page faults, "
+                   "%8.1f sysmem allocs/s %8.1fMB/s, %8.1f arena allocs/s\n",
+                   player_counts[i], p_arena_names[j], result.rss_kb / 1024.0, result.peak_rss_kb / 1024.0,
+                   result.page_faults,
+                   result.seconds ? result.allocs / result.seconds : 0.0,
+                   result.seconds ? (result.alloc_bytes / (1024.0 * 1024.0)) / result.seconds : 0.0,
+                   result.seconds ? result.arena_allocs / result.seconds : 0.0);
+
+            /* Numbers are meaningless if the sink kept its own pool and the arena never served a frame */
+            if (eMP_FRAME_ARENA_OFF != arenas[j])
+            {
+                CU_ASSERT(result.arena_allocs > 0);
+            }
+        }
+    }
+
+    g_free(p_uri);
+    (void)unlink(ARENA_BENCH_MEDIA_PATH);
+}
+
+/**
+ * \brief  Drop a file from the page cache, so the next read comes from disk
+ * 
+ * \param[in] p_path - file to drop
+ * 
+ * \return bool - true if the kernel was asked to drop it
+ * \author Jason Neitzert
+ */
+static bool probe_bench_drop_cache(const gchar *p_path)
+{
+    int  fd      = open(p_path, O_RDONLY);
+    bool dropped = false;
+
+    if (fd >= 0)
+    {
+        /* Dirty pages can't be dropped, so write them out first */
+        dropped = (0 == fdatasync(fd)) && (0 == posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED));
+        close(fd);
+    }
+
+    return dropped;
+}
+
+/**
+ * \brief  Benchmark scanning a media library with cold and warm probe cache
+ * \details Library is PROBE_BENCH_FILES files spread over containers and
+ *          codecs, and text and random files that aren't media. Every file
+ *          is its own copy, and is dropped from the page cache before the
+ *          cold scan so it reads from disk. Directory entries and inodes
+ *          stay cached, so the cold scan is still a best case for walking
+ *          the library. The warm scan reloads the cache from disk first,
+ *          as a new process would.
+ * 
+ * \return void
+ * \author Jason Neitzert
+ */
+static void bench_probe_scan()
+{
+    static const ProbeBenchKind kinds[] =
+    {
+        {"mkv", "videotestsrc num-buffers=30 ! video/x-raw,width=640,height=360 ! jpegenc ! matroskamux ! filesink location=%s"},
+        {"avi", "videotestsrc num-buffers=30 ! video/x-raw,width=640,height=360 ! jpegenc ! avimux ! filesink location=%s"},
+        {"mov", "videotestsrc num-buffers=30 ! video/x-raw,width=640,height=360 ! jpegenc ! qtmux ! filesink location=%s"},
+        {"ogv", "videotestsrc num-buffers=30 ! video/x-raw,width=640,height=360 ! theoraenc ! oggmux ! filesink location=%s"},
+        {"ogg", "audiotestsrc num-buffers=50 ! audioconvert ! vorbisenc ! oggmux ! filesink location=%s"},
+        {"wav", "audiotestsrc num-buffers=50 ! wavenc ! filesink location=%s"},
+        {"txt", NULL},
+        {"bin", NULL}
+    };
+    gchar     *p_sources[G_N_ELEMENTS(kinds)]      = {NULL};
+    gsize      source_lengths[G_N_ELEMENTS(kinds)] = {0};
+    GPtrArray *p_paths       = g_ptr_array_new_with_free_func(g_free);
+    gchar     *p_launch      = NULL;
+    gchar     *p_subdir      = NULL;
+    gchar     *p_path        = NULL;
+    gchar     *p_contents    = NULL;
+    gsize      length        = 0;
+    bool       written       = false;
+    gint64     start_time    = 0;
+    gint64     cold_time     = 0;
+    gint64     warm_time     = 0;
+    guint      media_files   = 0;
+    guint      dropped       = 0;
+    guint      cold_found    = 0;
+    guint      warm_found    = 0;
+    guint      kind          = 0;
+    guint      i             = 0;
+    guint      j             = 0;
+
+    /* Kinds whose encoder or muxer isn't installed are left out of the library */
+    for (kind = 0; kind < G_N_ELEMENTS(kinds); kind++)
+    {
+        if (kinds[kind].p_launch)
+        {
+            p_launch = g_strdup_printf(kinds[kind].p_launch, PROBE_BENCH_SOURCE_PATH);
+
+            if (test_generate_launch(p_launch))
+            {
+                (void)g_file_get_contents(PROBE_BENCH_SOURCE_PATH, &p_sources[kind], &source_lengths[kind], NULL);
+            }
+
+            g_free(p_launch);
+        }
+    }
+    (void)unlink(PROBE_BENCH_SOURCE_PATH);
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(p_sources[0]);
+    CU_ASSERT_FATAL(0 == g_mkdir_with_parents(PROBE_BENCH_DIRECTORY, 0755));
+
+    for (i = 0; i < PROBE_BENCH_FILES; i++)
+    {
+        kind       = i % G_N_ELEMENTS(kinds);
+        p_contents = NULL;
+        written    = false;
+        p_subdir   = g_strdup_printf(PROBE_BENCH_DIRECTORY "/%02u", i % PROBE_BENCH_SUBDIRS);
+        p_path     = g_strdup_printf("%s/file_%04u.%s", p_subdir, i, kinds[kind].p_extension);
+
+        (void)g_mkdir_with_parents(p_subdir, 0755);
+
+        if (kinds[kind].p_launch)
+        {
+            /* Written out as its own file, not a link, so page cache isn't shared with other copies */
+            written = p_sources[kind] && g_file_set_contents(p_path, p_sources[kind], source_lengths[kind], NULL);
+            media_files += written ? 1 : 0;
+        }
+        else if (!strcmp(kinds[kind].p_extension, "txt"))
+        {
+            p_contents = g_strdup_printf("Playlist %u\nNot media, just a text file next to the media\n", i);
+            length     = strlen(p_contents);
+        }
+        else if (!strcmp(kinds[kind].p_extension, "bin"))
+        {
+            length     = PROBE_BENCH_RANDOM_BYTES;
+            p_contents = g_malloc(length);
+            for (j = 0; j < (length / sizeof(guint32)); j++)
+            {
+                ((guint32*)p_contents)[j] = g_random_int();
+            }
+        }
+
+        if (p_contents)
+        {
+            written = g_file_set_contents(p_path, p_contents, length, NULL);
+            CU_ASSERT(written);
+            g_free(p_contents);
+        }
+
+        if (written)
+        {
+            g_ptr_array_add(p_paths, p_path);
+        }
+        else
+        {
+            g_free(p_path);
+        }
+
+        g_free(p_subdir);
+    }
+
+    for (i = 0; i < p_paths->len; i++)
+    {
+        if (probe_bench_drop_cache(g_ptr_array_index(p_paths, i)))
+        {
+            dropped++;
+        }
+    }
+
+    (void)unlink(PROBE_BENCH_CACHE_PATH);
+    CU_ASSERT(media_player_probe_set_cache(PROBE_BENCH_CACHE_PATH));
+
+    start_time = g_get_monotonic_time();
+    cold_found = media_player_probe_scan(PROBE_BENCH_DIRECTORY, NULL, NULL);
+    cold_time  = MAX(g_get_monotonic_time() - start_time, 1);
+
+    CU_ASSERT(media_player_probe_set_cache(PROBE_BENCH_CACHE_PATH));
+
+    start_time = g_get_monotonic_time();
+    warm_found = media_player_probe_scan(PROBE_BENCH_DIRECTORY, NULL, NULL);
+    warm_time  = MAX(g_get_monotonic_time() - start_time, 1);
+
+    printf("\nProbe scan of %u files (%u media) on %u cores, %u dropped from page cache: "
+           "cold %.1f files/s, warm %.1f files/s (%.1fx)\n",
+           p_paths->len, media_files, g_get_num_processors(), dropped,
+           (p_paths->len * (gdouble)G_USEC_PER_SEC) / cold_time, (p_paths->len * (gdouble)G_USEC_PER_SEC) / warm_time,
+           (gdouble)cold_time / warm_time);
+
+    /* Random data can now and then look enough like media to typefind, so only the real media is counted on */
+    CU_ASSERT(cold_found >= media_files);
+    CU_ASSERT(warm_found == cold_found);
+    CU_ASSERT(warm_time < cold_time);
+
+    (void)media_player_probe_set_cache(NULL);
+
+    for (i = 0; i < p_paths->len; i++)
+    {
+        (void)unlink(g_ptr_array_index(p_paths, i));
+    }
+
+    for (i = 0; i < PROBE_BENCH_SUBDIRS; i++)
+    {
+        p_subdir = g_strdup_printf(PROBE_BENCH_DIRECTORY "/%02u", i);
+        (void)rmdir(p_subdir);
+        g_free(p_subdir);
+    }
+
+    for (kind = 0; kind < G_N_ELEMENTS(kinds); kind++)
+    {
+        g_free(p_sources[kind]);
+    }
+
+    g_ptr_array_unref(p_paths);
+    (void)rmdir(PROBE_BENCH_DIRECTORY);
+    (void)unlink(PROBE_BENCH_CACHE_PATH);
+}
+
+/************************* Public Functions ******************/
+
+/**
+ * \brief  Main(Need I say more)
+ * \details With ARENA_BENCH_CHILD_ARG runs one frame arena bench
+ *          configuration, and with SHM_CONSUMER_CHILD_ARG a shared memory
+ *          consumer, instead of the tests.
+ * 
+ * \param[in] argc - argument count
+ * \param[in] argv - arguments
+ * 
+ * \return int - value you would like process to return on exit
+ * \author Jason Neitzert
+ */
+int main(int argc, char *argv[])
+{
+    CU_Suite *p_media_player_suite        = NULL;
+    CU_Suite *p_media_player_memory_suite = NULL;
+    CU_Suite *p_media_player_bench_suite  = NULL;
+    CU_Suite *p_analytics_suite           = NULL;
+    CU_Suite *p_shm_suite                 = NULL;
+    int       retval                      = 0;
+
+    if ((5 == argc) && !strcmp(argv[1], ARENA_BENCH_CHILD_ARG))
+    {
+        retval = arena_bench_child((guint)g_ascii_strtoull(argv[2], NULL, 10),
+                                   (MpFrameArena)g_ascii_strtoull(argv[3], NULL, 10), argv[4]);
+    }
+    else if ((4 == argc) && !strcmp(argv[1], SHM_CONSUMER_CHILD_ARG))
+    {
+        retval = shm_consumer_child(argv[2], argv[3]);
+    }
+    else if (CUE_SUCCESS != CU_initialize_registry())
+    {
+        printf("\nFailed To Init CUnit");
+    }
+    else
+    {
+        /* All the tests here will use media player library */
+        media_player_api_init();
+        
+        /* Add suite and tests for general playback */
+        p_media_player_suite = CU_add_suite("media_player_tests", NULL, NULL);
+        CU_add_test(p_media_player_suite, "Playback", unit_test_play);
+        CU_add_test(p_media_player_suite, "Pause", unit_test_pause);
+        CU_add_test(p_media_player_suite, "EOS", unit_test_eos);
+        CU_add_test(p_media_player_suite, "Position", unit_test_position);
+        CU_add_test(p_media_player_suite, "Frame Arena", unit_test_frame_arena);
+        CU_add_test(p_media_player_suite, "Governor", unit_test_governor);
+        CU_add_test(p_media_player_suite, "Probe", unit_test_probe);
+
+        /* Add suite and tests for frame analytics */
+        p_analytics_suite = CU_add_suite("media_player_analytics_tests", NULL, NULL);
+        CU_add_test(p_analytics_suite, "Analytics Events", unit_test_analytics_events);
+
+        /* Add suite and tests for shared memory frame export */
+        p_shm_suite = CU_add_suite("media_player_shm_tests", NULL, NULL);
+        CU_add_test(p_shm_suite, "Shared Memory Export", unit_test_shm_export);
+        CU_add_test(p_shm_suite, "Shared Memory Consumer Crash", unit_test_shm_consumer_crash);
+        CU_add_test(p_shm_suite, "Shared Memory Socket Path", unit_test_shm_socket_path);
+
+        /* Add suite for performance benchmarks */
+        p_media_player_bench_suite = CU_add_suite("media_player_benchmarks", NULL, NULL);
+        CU_add_test(p_media_player_bench_suite, "Snapshot Query Cost", bench_snapshot_query_cost);
+        CU_add_test(p_media_player_bench_suite, "Snapshot Polling At Scale", bench_snapshot_poll_scale);
+        CU_add_test(p_media_player_bench_suite, "Analytics Kernels", bench_analytics_kernels);
+        CU_add_test(p_media_player_bench_suite, "Shared Memory Export", bench_shm_export);
+        CU_add_test(p_media_player_bench_suite, "Frame Arena", bench_frame_arena);
+        CU_add_test(p_media_player_bench_suite, "Probe Scan", bench_probe_scan);
 
         /* Add suite and tests for memory testing */
         p_media_player_memory_suite = CU_add_suite("media_player_memory_tests", NULL, NULL);
@@ -188,6 +1919,6 @@ int main()
         CU_cleanup_registry();
     }
 
-    return 0;
+    return retval;
    
 }
\ No newline at end of file